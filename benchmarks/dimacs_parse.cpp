@@ -0,0 +1,120 @@
+/*****************************************************************************
+Copyright (C) 2018  Mate Soos, Davin Choo, Kian Ming A. Chai, DSO National Laboratories
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***********************************************/
+
+
+// Compares the DIMACSCache reader against the istringstream-based parser it
+// replaced. Usage: dimacs-parse-bench FILE.cnf [repetitions]
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "dimacscache.hpp"
+
+using std::cout;
+using std::endl;
+
+static void legacy_parse(const char* fname, vector<Clause>& clauses,
+                         uint32_t& maxVar)
+{
+    std::ifstream ifs;
+    std::string temp;
+    std::string x;
+    ifs.open(fname);
+    if (!ifs) {
+        cout << "ERROR: Problem opening file '" << fname << "' for reading\n";
+        exit(-1);
+    }
+
+    vector<Lit> lits;
+    while (std::getline(ifs, temp)) {
+        if (temp.length() == 0 || temp[0] == 'p' || temp[0] == 'c') {
+            continue;
+        } else {
+            std::istringstream iss(temp);
+            lits.clear();
+            while (iss.good() && !iss.eof()) {
+                iss >> x;
+                int v = stoi(x);
+                if (v == 0) {
+                    clauses.push_back(Clause(lits));
+                    break;
+                } else {
+                    lits.push_back(Lit(std::abs(v) - 1, v < 0));
+                }
+                maxVar = std::max<uint32_t>(maxVar, std::abs(stoi(x)));
+            }
+        }
+    }
+}
+
+template <class F>
+static double time_it(const int reps, F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < reps; i++) {
+        f();
+    }
+    std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+    return d.count() / reps;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        cout << "Usage: " << argv[0] << " FILE.cnf [repetitions]" << endl;
+        return -1;
+    }
+    const char* fname = argv[1];
+    const int reps = (argc > 2) ? std::atoi(argv[2]) : 3;
+
+    vector<Clause> legacy;
+    uint32_t legacyMaxVar = 0;
+    const double legacyTime = time_it(reps, [&]() {
+        legacy.clear();
+        legacyMaxVar = 0;
+        legacy_parse(fname, legacy, legacyMaxVar);
+    });
+
+    size_t numCls = 0;
+    const double newTime = time_it(reps, [&]() {
+        BLib::DIMACSCache dimacs(fname);
+        numCls = dimacs.getClauses().size();
+    });
+
+    BLib::DIMACSCache dimacs(fname);
+    bool same = dimacs.getMaxVar() == legacyMaxVar &&
+                dimacs.getClauses().size() == legacy.size();
+    for (size_t i = 0; same && i < legacy.size(); i++) {
+        same = dimacs.getClauses()[i].getLits() == legacy[i].getLits();
+    }
+
+    cout << "clauses: " << numCls << " maxVar: " << dimacs.getMaxVar() << endl
+         << "legacy parser: " << legacyTime << " s" << endl
+         << "DIMACSCache:   " << newTime << " s" << endl
+         << "speedup:       " << legacyTime / newTime << "x" << endl
+         << "results " << (same ? "match" : "DIFFER") << endl;
+    return same ? 0 : 1;
+}
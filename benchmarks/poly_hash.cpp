@@ -0,0 +1,118 @@
+/*****************************************************************************
+Copyright (C) 2018  Mate Soos, Davin Choo, Kian Ming A. Chai, DSO National Laboratories
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***********************************************/
+
+
+// Compares PolySet against the unordered_set of hashes it replaced, for
+// inserting random polynomials and looking them up again.
+// Usage: poly-hash-bench [polynomials] [variables] [repetitions]
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <unordered_set>
+#include <vector>
+
+#include "polyhashtable.hpp"
+
+USING_NAMESPACE_PBORI
+
+using std::cout;
+using std::endl;
+using std::vector;
+
+template <class F>
+static double time_it(const int reps, F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < reps; i++) {
+        f();
+    }
+    std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+    return d.count() / reps;
+}
+
+// Quadratic, with up to 8 terms
+static BoolePolynomial random_poly(const BoolePolyRing& ring,
+                                   const size_t numVars)
+{
+    BoolePolynomial p(rand() % 2, ring);
+    const int terms = 1 + rand() % 8;
+    for (int t = 0; t < terms; t++) {
+        BooleMonomial m = ring.variable(rand() % numVars);
+        if (rand() % 2) {
+            m *= ring.variable(rand() % numVars);
+        }
+        p += m;
+    }
+    return p;
+}
+
+int main(int argc, char** argv)
+{
+    const size_t num = (argc > 1) ? std::atol(argv[1]) : 200000;
+    const size_t numVars = (argc > 2) ? std::atol(argv[2]) : 1000;
+    const int reps = (argc > 3) ? std::atoi(argv[3]) : 3;
+
+    BoolePolyRing ring(numVars);
+    vector<BoolePolynomial> polys;
+    polys.reserve(num);
+    for (size_t i = 0; i < num; i++) {
+        polys.push_back(random_poly(ring, numVars));
+    }
+
+    size_t legacyFound = 0;
+    const double legacyTime = time_it(reps, [&]() {
+        std::unordered_set<BoolePolynomial::hash_type> set;
+        for (const BoolePolynomial& p : polys) {
+            set.insert(p.hash());
+        }
+        legacyFound = 0;
+        for (const BoolePolynomial& p : polys) {
+            legacyFound += set.find(p.hash()) != set.end();
+        }
+    });
+
+    size_t newFound = 0;
+    size_t unique = 0;
+    const double newTime = time_it(reps, [&]() {
+        BLib::PolySet set;
+        for (const BoolePolynomial& p : polys) {
+            set.insert(p);
+        }
+        newFound = 0;
+        for (const BoolePolynomial& p : polys) {
+            newFound += set.contains(p);
+        }
+        unique = set.size();
+    });
+
+    const double ops = 2.0 * num;
+    cout << "polynomials: " << num << " unique: " << unique << endl
+         << "unordered_set: " << legacyTime << " s ("
+         << ops / legacyTime << " ops/s)" << endl
+         << "PolySet:       " << newTime << " s (" << ops / newTime
+         << " ops/s)" << endl
+         << "speedup:       " << legacyTime / newTime << "x" << endl
+         << "results " << (legacyFound == newFound ? "match" : "DIFFER")
+         << endl;
+    return legacyFound == newFound ? 0 : 1;
+}
@@ -23,12 +23,13 @@ SOFTWARE.
 
 #include "anf.hpp"
 
-#include <cctype>
 #include <fstream>
 #include <string>
-#include <boost/lexical_cast.hpp>
 #include <iomanip>
 
+#include "anfbinary.hpp"
+#include "anfparser.hpp"
+#include "anfutils.hpp"
 #include "replacer.hpp"
 #include "time_mem.h"
 
@@ -39,15 +40,18 @@ using namespace BLib;
 ANF::ANF(const polybori::BoolePolyRing* _ring, ConfigData& _config)
     : ring(_ring),
       config(_config),
-      replacer(new Replacer)
+      replacer(new Replacer),
+      linear(_ring->nVariables()),
+      linearFed(_ring->nVariables(), 0)
 {
     //ensure that the variables are not new
     for (size_t i = 0; i < ring->nVariables(); i++) {
         replacer->newVar(i);
     }
 
-    assert(occur.empty());
+    assert(occur.numVars() == 0);
     occur.resize(ring->nVariables());
+    implied.resize(2 * ring->nVariables());
 }
 
 ANF::~ANF()
@@ -56,332 +60,123 @@ ANF::~ANF()
         delete replacer;
 }
 
-size_t ANF::readFileForMaxVar(const std::string& filename)
+void ANF::readFile(const ANFParser& parser)
 {
-    // Read in the file line by line
-    size_t maxVar = 0;
-
-    std::ifstream ifs(filename.c_str());
-    if (!ifs) {
-        cout << "Problem opening file: \"" << filename << "\" for reading\n";
-        exit(-1);
-    }
-
-    std::string temp;
-    while (std::getline(ifs, temp)) {
-        // Empty lines and comments (esp numbers within) are ignored
-        if (temp.length() == 0 || temp[0] == 'c')
+    comments = parser.getComments();
+    proj_set = parser.getProjSet();
+    origVars = parser.getOrigVars();
+
+    PolynomialBuilder builder(*ring);
+    const auto& factoredPolys = parser.getFactored();
+    auto nextFactored = factoredPolys.begin();
+    for (size_t p = 0; p < parser.getNumPolys(); p++) {
+        // Bracketed ones are expanded with ZDD operations, and kept around
+        // so that the CNF can be generated from the factored form
+        if (nextFactored != factoredPolys.end() && nextFactored->first == p) {
+            const FactoredPoly& fp = nextFactored->second;
+            BoolePolynomial eq = expand_factored(fp, *ring)[0];
+            factored.insert(std::make_pair(eq.hash(), std::make_pair(eq, fp)));
+            addBoolePolynomial(eq);
+            nextFactored++;
             continue;
+        }
 
-        // simply search for consecutive numbers
-        // however "+1" is a NUMBER but not a MONOMIAL
-        // so we have to take that into consideration
-        size_t var = 0;
-        bool isMonomial = false;
-        for (uint32_t i = 0; i < temp.length(); ++i) {
-            //At this point, only numbers are valid
-            if (!std::isdigit(temp[i])) {
-                var = 0;
-                if (temp[i] == 'x' || (isMonomial && temp[i] == '(')) {
-                    isMonomial = true;
-                } else {
-                    isMonomial = false;
-                }
-            } else if (isMonomial) {
-                var = var * 10 + (temp[i] - '0');
-                maxVar = std::max(
-                    maxVar,
-                    var); //This variable will be used, no matter what, so use it as max
-            }
+        for (size_t i = parser.polyBegin(p); i < parser.polyEnd(p); i++) {
+            //The empty monomial is the constant '1'
+            builder.addMonomial(parser.monoBegin(i), parser.monoEnd(i));
         }
+        addBoolePolynomial(builder.build());
     }
-    ifs.close();
-    return maxVar;
 }
 
-size_t ANF::readFile(const std::string& filename)
+void ANF::saveBinary(BinaryWriter& w) const
 {
-    // Read in the file line by line
-    vector<std::string> text_file;
+    w.writeVarint(comments.size());
+    for (const string& c : comments) {
+        w.writeString(c);
+    }
 
-    size_t maxVar = 0;
-    bool proj_set_found = false;
+    w.writeVarint(origVars.size());
+    for (const uint32_t v : origVars) {
+        w.writeVarint(v);
+    }
 
-    std::ifstream ifs;
-    ifs.open(filename.c_str());
-    if (!ifs) {
-        cout << "Problem opening file: \"" << filename << "\" for reading\n";
-        exit(-1);
+    w.writeVarint(proj_set.size());
+    size_t prev = 0;
+    for (const size_t v : proj_set) {
+        w.writeVarint(v - prev);
+        prev = v;
     }
-    std::string temp;
 
-    while (std::getline(ifs, temp)) {
-        // Empty lines are ignored
-        if (temp.length() == 0) {
-            continue;
-        }
+    replacer->saveBinary(w);
 
-        // Save comments
-        if (temp.length() > 0 && temp[0] == 'c') {
-            comments.push_back(temp);
-            if (!proj_set.empty()) {
-                cout << "ERROR: you have more than one 'c p show' in your ANF file, i.e. more than one projection set. This is not allowed." << endl;
-                exit(-1);
-            }
-            std::istringstream iss(temp);
-            std::string txt;
-            iss >> txt;
-            if (txt != "c") continue;
-            iss >> txt;
-            if (txt != "p") continue;
-            iss >> txt;
-            if (txt != "show") continue;
-            proj_set_found = true;
-            while(true) {
-                iss >> txt;
-                if (txt == "END") break;
-                int i;
-                if(sscanf(txt.c_str(), "x%d", &i) != 1) {
-                    cout << "ERROR: in projection set, there is a malformed value, it should be xNUM, but it's: '" << txt << "'" << endl;
-                    exit(-1);
-                }
-                if (i < 0) {
-                    cout << "ERROR: projection set must ONLY contain positive integers" << endl;
-                    exit(-1);
-                }
-                if (proj_set.find(i) != proj_set.end()) {
-                    cout << "ERROR: you are either adding '" << i << "' twice into the projection set, or your forgot to type 'END' at the end of the projection set" << endl;
-                    exit(-1);
-                }
-                proj_set.insert(i);
-            }
+    // Counted here rather than taken from size(), so that the count always
+    // matches the polynomials written below
+    size_t numEqs = 0;
+    for (const BoolePolynomial& poly : eqs) {
+        numEqs += !poly.isZero();
+    }
+    w.writeVarint(numEqs);
+    for (const BoolePolynomial& poly : eqs) {
+        if (poly.isZero()) {
             continue;
         }
+        w.writePoly(poly);
+    }
+}
 
-        BoolePolynomial eq(*ring);
-        BoolePolynomial eqDesc(*ring);
-        bool startOfVar = false;
-        bool readInVar = false;
-        bool readInDesc = false;
-        bool start_bracket = false;
-
-        size_t var = 0;
-        BooleMonomial m(*ring);
-        for (uint32_t i = 0; i < temp.length(); i++) {
-            //Handle description separator ','
-            if (temp[i] == ',') {
-                if (readInVar) {
-                    m *= BooleVariable(var, *ring);
-                    eq += m;
-                }
-
-                startOfVar = false;
-                readInVar = false;
-                var = 0;
-                m = BooleMonomial(*ring);
-                readInDesc = true;
-                continue;
-            }
-
-            //Silently ignore brackets.
-            //This makes the 'parser' work for both "x3" and "x(3)"
-            if (temp[i] == ')') {
-                if (!start_bracket) {
-                    cout << "ERROR: close bracket but no start bracket?" << endl;
-                    exit(-1);
-                }
-                start_bracket = false;
-                continue;
-            }
-            if (temp[i] == '(') {
-                if (start_bracket) {
-                    cout << "ERROR: start bracket but previous not closed?" << endl;
-                    exit(-1);
-                }
-                start_bracket = true;
-                continue;
-            }
-
-            //Space means end of variable
-            if (temp[i] == ' ') {
-                if (startOfVar && !readInVar) {
-                    cout << "x is not followed by number at this line : \""
-                         << temp << "\"" << endl;
-                    exit(-1);
-                }
-                startOfVar = false;
-                continue;
-            }
-
-            if (temp[i] == 'x' || temp[i] == 'X') {
-                startOfVar = true;
-                readInVar = false;
-                continue;
-            }
-
-            //Handle constant '1'
-            if (temp[i] == '1' && !startOfVar) {
-                if (!readInDesc)
-                    eq += BooleConstant(true);
-                else
-                    eqDesc += BooleConstant(true);
-                readInVar = false;
-                continue;
-            }
-
-            //Handle constant '0'
-            if (temp[i] == '0' && !startOfVar) {
-                if (!readInDesc)
-                    eq += BooleConstant(false);
-                else
-                    eqDesc += BooleConstant(false);
-                readInVar = false;
-                continue;
-            }
-
-            if (temp[i] == '+') {
-                if (start_bracket) {
-                    cout << "ERROR: You are adding monomials, but haven't closed the previous one! We can only parse ANF, not e.g. ternary factorized systems" << endl;
-                    exit(-1);
-                }
-                if (readInVar) {
-                    m *= BooleVariable(var, *ring);
-
-                    if (!readInDesc)
-                        eq += m;
-                    else
-                        eqDesc += m;
-                }
-
-                startOfVar = false;
-                readInVar = false;
-                var = 0;
-                m = BooleMonomial(*ring);
-                continue;
-            }
-
-            if (temp[i] == '*') {
-                if (!readInVar) {
-                    cout << "ERROR: No variable before \"*\" in equation: \"" << temp
-                         << "\"" << endl;
-                    exit(-1);
-                }
-
-                //Multiplying current var into monomial
-                m *= BooleVariable(var, *ring);
-
-                startOfVar = false;
-                readInVar = false;
-                var = 0;
-                continue;
-            }
-
-            //Deal with carriage return. Thanks Windows!
-            if (temp[i] == 13) {
-                continue;
-            }
-
-            //At this point, only numbers are valid
-            if (temp[i] < '0' || temp[i] > '9') {
-                cout << "ERROR: Unknown character 0x" << (int)temp[i]
-                     << " in equation: " << temp << "\"" << endl;
-                exit(-1);
-            }
-
-            if (!startOfVar) {
-                cout << "ERROR: Value of variable is BEFORE \"x\" in the equation: \"" << temp
-                     << "\"" << endl;
-                exit(-1);
-            }
-            readInVar = true;
-            int vartmp = temp[i] - '0';
-            assert(vartmp >= 0 && vartmp <= 9);
-            var *= 10;
-            var += vartmp;
-
-            //This variable will be used, no matter what, so use it as max
-            maxVar = std::max(maxVar, var);
-        }
-
-        //If variable was being built up when the line ended, add it
-        if (readInVar) {
-            m *= BooleVariable(var, *ring);
-
-            if (!readInDesc)
-                eq += m;
-            else
-                eqDesc += m;
-        }
-
-        //Set state to starting position
-        startOfVar = false;
-        readInVar = false;
-        var = 0;
-        m = BooleMonomial(*ring);
-
-        size_t realTermsSize = eqDesc.length() - (int)eqDesc.hasConstantPart();
-        if (realTermsSize > 1) {
-            cout << "ERROR!" << endl
-                 << "After the comma, only a monomial is supported (not an "
-                    "equation)"
-                 << endl
-                 << "But You gave: " << eqDesc << " on line: '" << temp << "'"
-                 << endl;
-            exit(-1);
-        }
-
-        if (realTermsSize == 1 && eqDesc.firstTerm().deg() > 1) {
-            cout << "ERROR! " << endl
-                 << "After the comma, only a single-var monomial is supported "
-                    "(no multi-var monomial)"
-                 << endl
-                 << "You gave: " << eqDesc << " on line: " << temp << endl;
-            exit(-1);
-        }
-
-        addBoolePolynomial(eq);
-        if (start_bracket) {
-            cout << "ERROR: end of line but bracket not closed" << endl;
-            exit(-1);
-        }
+void ANF::loadBinary(BinaryReader& r)
+{
+    comments.resize(r.readVarint());
+    for (string& c : comments) {
+        c = r.readString();
     }
 
-    for(const auto& v: proj_set) {
-        if (v > maxVar) {
-            cout << "ERROR: the maximum variable in the ANF was: x" << maxVar << " but your projection set contains var x" << v << " which is higher. This is wrong." << endl;
-            exit(-1);
-        }
+    origVars.resize(r.readVarint());
+    for (uint32_t& v : origVars) {
+        v = r.readVarint();
     }
 
-    if (proj_set_found == false) {
-        cout << "c setting projection set to ALL variables since we didn't find a 'c p show ... END'" << endl;
-        for(uint32_t i = 0; i <= maxVar; i++) {
-            proj_set.insert(i);
-        }
+    proj_set.clear();
+    const uint64_t projSize = r.readVarint();
+    size_t v = 0;
+    for (uint64_t i = 0; i < projSize; i++) {
+        v += r.readVarint();
+        proj_set.insert(v);
     }
 
-    ifs.close();
-    return maxVar;
+    replacer->loadBinary(r);
+
+    PolynomialBuilder builder(*ring);
+    const uint64_t numEqs = r.readVarint();
+    for (uint64_t i = 0; i < numEqs; i++) {
+        addBoolePolynomial(r.readPoly(builder));
+    }
 }
 
 void print_solution_map(std::ofstream* ) { }
 
 // KMA Chai: Check if this polynomial can cause further ANF propagation
-bool ANF::check_if_need_update(const BoolePolynomial& poly,
-                               unordered_set<uint32_t>& updatedVars)
+bool ANF::check_if_need_update(const size_t eq_idx, VarQueue& updatedVars)
 {
+    // The number of variables and the degree are cached, only the shapes
+    // that are left are looked at
+    const BoolePolynomial& poly = eqs[eq_idx];
+    const uint32_t nvars = eqs_shape[eq_idx].nvars;
+    const int deg = eqs_shape[eq_idx].deg;
+
     //////////////////
     // Assign values
     //////////////////
 
     // If polynomial is "x = 0" or "x + 1 = 0", set the value of x
-    if (poly.nUsedVariables() == 1 && poly.deg() == 1) {
+    if (nvars == 1 && deg == 1) {
         uint32_t v = poly.usedVariables().firstVariable().index();
         auto updated_vars = replacer->setValue(v, poly.hasConstantPart());
 
         // Mark updated vars
         for (const uint32_t& var : updated_vars) {
-            updatedVars.insert(var);
+            updatedVars.push(var);
         }
         return true;
     }
@@ -393,7 +188,7 @@ bool ANF::check_if_need_update(const BoolePolynomial& poly,
 
             // Mark updated vars
             for (const uint32_t var : updated_vars) {
-                updatedVars.insert(var);
+                updatedVars.push(var);
             }
         }
         return true;
@@ -404,7 +199,7 @@ bool ANF::check_if_need_update(const BoolePolynomial& poly,
     //////////////////
 
     // If polynomial is "x + y = 0" or "x + y + 1 = 0", set the value of x in terms of y
-    if (poly.nUsedVariables() == 2 && poly.deg() == 1) {
+    if (nvars == 2 && deg == 1) {
         uint32_t var[2];
         size_t i = 0;
         for (const uint32_t v : poly.usedVariables()) {
@@ -414,18 +209,234 @@ bool ANF::check_if_need_update(const BoolePolynomial& poly,
         // Make the update
         vector<uint32_t> ret =
             replacer->setReplace(var[0], Lit(var[1], poly.hasConstantPart()));
-        updatedVars.insert(var[0]);
-        updatedVars.insert(var[1]);
+        updatedVars.push(var[0]);
+        updatedVars.push(var[1]);
 
         // Mark updated vars
         for (const uint32_t& var_idx : ret) {
-            updatedVars.insert(var_idx);
+            updatedVars.push(var_idx);
         }
         return true;
     }
+
+    //////////////////
+    // Binary clauses
+    //////////////////
+
+    if (nvars == 2) {
+        return check_two_vars(poly, updatedVars);
+    }
+
+    //////////////////
+    // Longer XORs
+    //////////////////
+
+    if (deg == 1) {
+        vector<uint32_t> vars;
+        bool rhs = false;
+        for (const BooleMonomial& mono : poly) {
+            if (mono.isOne()) {
+                rhs = true;
+            } else {
+                vars.push_back(mono.firstIndex());
+            }
+        }
+        return addLinear(vars, rhs, updatedVars);
+    }
+
+    // If polynomial is "x*m + x = 0", i.e. "x*(m + 1) = 0", then x implies
+    // each variable of m
+    uint32_t x;
+    if (is_implication_pair(poly, x)) {
+        bool updated = false;
+        for (const uint32_t v : poly.usedVariables()) {
+            if (v != x) {
+                updated |= addBinary(Lit(x, true), Lit(v, false), updatedVars);
+            }
+        }
+        return updated;
+    }
+    return false;
+}
+
+// Any non-linear equation over two variables rules out one or three of
+// their four assignments. Returns true if it sets some variables.
+bool ANF::check_two_vars(const BoolePolynomial& poly, VarQueue& updatedVars)
+{
+    uint32_t var[2];
+    size_t i = 0;
+    for (const uint32_t v : poly.usedVariables()) {
+        var[i++] = v;
+    }
+
+    // Bit 'a + 2*b' of 'ones' is set if the polynomial is 1 at var[0] = a,
+    // var[1] = b, i.e. if that assignment is ruled out
+    unsigned ones = 0;
+    for (const BooleMonomial& mono : poly) {
+        unsigned mask = 0xF;
+        for (const uint32_t v : mono) {
+            mask &= (v == var[0]) ? 0xA : 0xC;
+        }
+        ones ^= mask;
+    }
+
+    size_t numOnes = 0;
+    for (unsigned k = 0; k < 4; k++) {
+        numOnes += (ones >> k) & 1;
+    }
+
+    if (numOnes == 4) {
+        replacer->setNOTOK();
+        return false;
+    }
+
+    // Only one assignment is left
+    if (numOnes == 3) {
+        unsigned k = 0;
+        while ((ones >> k) & 1) {
+            k++;
+        }
+        setLit(Lit(var[0], !(k & 1)), updatedVars);
+        setLit(Lit(var[1], !(k & 2)), updatedVars);
+        return true;
+    }
+
+    // One assignment is ruled out: a binary clause. Two ruled out would be
+    // an (anti)equivalence, which is linear and is handled above.
+    if (numOnes == 1) {
+        unsigned k = 0;
+        while (!((ones >> k) & 1)) {
+            k++;
+        }
+        return addBinary(Lit(var[0], k & 1), Lit(var[1], k & 2), updatedVars);
+    }
+    return false;
+}
+
+// Adds the clause "a OR b". Returns true if it sets some variables.
+bool ANF::addBinary(const Lit a, const Lit b, VarQueue& updatedVars)
+{
+    assert(a.var() != b.var());
+    const lbool valA = value(a.var()) ^ a.sign();
+    const lbool valB = value(b.var()) ^ b.sign();
+    if (valA == l_True || valB == l_True) {
+        return false;
+    }
+    if (valA == l_False) {
+        setLit(b, updatedVars);
+        return true;
+    }
+    if (valB == l_False) {
+        setLit(a, updatedVars);
+        return true;
+    }
+
+    // "a OR b" and "a OR ~b" give a
+    for (const Lit lit : implied[(~a).toInt()]) {
+        if (lit == ~b) {
+            setLit(a, updatedVars);
+            return true;
+        }
+    }
+    for (const Lit lit : implied[(~b).toInt()]) {
+        if (lit == ~a) {
+            setLit(b, updatedVars);
+            return true;
+        }
+    }
+
+    implied[(~a).toInt()].push_back(b);
+    implied[(~b).toInt()].push_back(a);
     return false;
 }
 
+void ANF::setLit(const Lit lit, VarQueue& updatedVars)
+{
+    for (const uint32_t v : replacer->setValue(lit.var(), !lit.sign())) {
+        updatedVars.push(v);
+    }
+}
+
+// Adds a linear equation to the engine, and hands the values and
+// (anti)equivalences it finds to the replacer. Returns true if it finds any.
+bool ANF::addLinear(const vector<uint32_t>& vars, const bool rhs,
+                    VarQueue& updatedVars)
+{
+    vector<LinearFact> facts;
+    const bool wasFull = linear.isFull();
+    if (!linear.add(vars, rhs, facts)) {
+        replacer->setNOTOK();
+        return false;
+    }
+    if (!wasFull && linear.isFull() && config.verbosity >= 1) {
+        cout << "c [ANF prop] Linear engine is full at " << linear.numRows()
+             << " rows and " << linear.numCols()
+             << " columns, further linear equations are left to ElimLin/XL"
+             << endl;
+    }
+
+    for (const LinearFact& fact : facts) {
+        if (fact.num == 1) {
+            setLit(Lit(fact.vars[0], !fact.rhs), updatedVars);
+            continue;
+        }
+        updatedVars.push(fact.vars[0]);
+        updatedVars.push(fact.vars[1]);
+        for (const uint32_t v : replacer->setReplace(
+                 fact.vars[0], Lit(fact.vars[1], fact.rhs))) {
+            updatedVars.push(v);
+        }
+    }
+    return !facts.empty();
+}
+
+// Gives the engine the value or the replacement of 'var', once each
+void ANF::feedLinear(const uint32_t var, VarQueue& updatedVars)
+{
+    vector<uint32_t> vars(1, var);
+    bool rhs;
+    if (value(var) != l_Undef) {
+        if (linearFed[var] == 2) {
+            return;
+        }
+        linearFed[var] = 2;
+        rhs = (value(var) == l_True);
+    } else {
+        const Lit lit = getReplaced(var);
+        if (lit.var() == var || linearFed[var] != 0) {
+            return;
+        }
+        linearFed[var] = 1;
+        vars.push_back(lit.var());
+        rhs = lit.sign();
+    }
+    addLinear(vars, rhs, updatedVars);
+}
+
+// 'var' got a value: set what it implies. Both of its lists are spent.
+void ANF::fireImplications(const uint32_t var, VarQueue& updatedVars)
+{
+    const Lit holds(var, value(var) == l_False);
+    vector<Lit> toSet;
+    toSet.swap(implied[holds.toInt()]);
+    vector<Lit>().swap(implied[(~holds).toInt()]);
+    for (const Lit lit : toSet) {
+        setLit(lit, updatedVars);
+    }
+}
+
+void ANF::reserve(const size_t numEqs,
+                  const vector<std::pair<uint32_t, size_t> >& varCount)
+{
+    eqs.reserve(eqs.size() + numEqs);
+    eqs_hash.reserve(eqs_hash.size() + numEqs);
+    eqs_shape.reserve(eqs_shape.size() + numEqs);
+    for (const auto& vc : varCount) {
+        assert(vc.first < occur.numVars());
+        occur.reserve(vc.first, vc.second);
+    }
+}
+
 bool ANF::addBoolePolynomial(const BoolePolynomial& poly)
 {
     // Don't add constants
@@ -438,67 +449,81 @@ bool ANF::addBoolePolynomial(const BoolePolynomial& poly)
     }
 
     // If poly already present, don't add it
-    auto ins = eqs_hash.insert(poly.hash());
-    if (!ins.second)
+    if (!hashInsert(poly))
         return false;
 
-    addPolyToOccur(poly, eqs.size());
+    const BooleMonomial used = poly.usedVariables();
+    occur.add(eqs.size(), used);
 
     eqs.push_back(poly);
+    eqs_shape.push_back(EqShape{(uint32_t)used.deg(), poly.deg()});
 
     return true;
 }
 
-bool ANF::addLearntBoolePolynomial(const BoolePolynomial& poly)
+bool ANF::hashInsert(const BoolePolynomial& p)
 {
-    // Contextualize it to existing knowledge
-    BoolePolynomial contextualized_poly = replacer->update(poly);
-    bool added = addBoolePolynomial(contextualized_poly);
-    if (added && config.verbosity >= 6) {
-        cout << "c Adding: " << poly << endl
-             << "c as    : " << contextualized_poly << endl;
+    if (!eqs_hash.insert(p)) {
+        return false;
     }
-
-    return added;
+    if (snapshotOn && !snapRemoved.erase(p)) {
+        snapAdded.insert(p);
+    }
+    return true;
 }
 
-// Slow. O(n^2) because cannot use set<> for BoolePolynomial; KMACHAI: don't understand this comment.....
-void ANF::contextualize(vector<BoolePolynomial>& learnt) const
+bool ANF::hashErase(const BoolePolynomial& p)
 {
-    for (size_t i = 0; i < learnt.size(); ++i)
-        learnt[i] = replacer->update(learnt[i]);
+    if (!eqs_hash.erase(p)) {
+        return false;
+    }
+    if (snapshotOn && !snapAdded.erase(p)) {
+        snapRemoved.insert(p);
+    }
+    return true;
 }
 
-void ANF::addPolyToOccur(const BooleMonomial& mono, const size_t eq_idx)
+void ANF::takeSnapshot()
 {
-    for (const uint32_t var_idx : mono) {
-        occur[var_idx].push_back(eq_idx);
-    }
+    snapAdded.clear();
+    snapRemoved.clear();
+    snapshotOn = true;
 }
 
-void ANF::removePolyFromOccur(const BooleMonomial& mono, size_t eq_idx)
+void ANF::dropSnapshot()
 {
-    //Remove from occur
-    for (const uint32_t var_idx : mono) {
-        vector<size_t>::iterator findIt =
-            std::find(occur[var_idx].begin(), occur[var_idx].end(), eq_idx);
-        assert(findIt != occur[var_idx].end());
+    snapAdded.clear();
+    snapRemoved.clear();
+    snapshotOn = false;
+}
 
-        // use swap to erase, because order doesn't matter
-        *findIt = occur[var_idx].back();
-        occur[var_idx].pop_back();
+bool ANF::inSnapshot(const BoolePolynomial& p) const
+{
+    assert(snapshotOn);
+    if (snapRemoved.contains(p)) {
+        return true;
     }
+    return eqs_hash.contains(p) && !snapAdded.contains(p);
 }
 
-inline void ANF::addPolyToOccur(const BoolePolynomial& poly,
-                                const size_t eq_idx)
+bool ANF::addLearntBoolePolynomial(const BoolePolynomial& poly)
 {
-    addPolyToOccur(poly.usedVariables(), eq_idx);
+    // Contextualize it to existing knowledge
+    BoolePolynomial contextualized_poly = replacer->update(poly);
+    bool added = addBoolePolynomial(contextualized_poly);
+    if (added && config.verbosity >= 6) {
+        cout << "c Adding: " << poly << endl
+             << "c as    : " << contextualized_poly << endl;
+    }
+
+    return added;
 }
 
-inline void ANF::removePolyFromOccur(const BoolePolynomial& poly, size_t eq_idx)
+// Slow. O(n^2) because cannot use set<> for BoolePolynomial; KMACHAI: don't understand this comment.....
+void ANF::contextualize(vector<BoolePolynomial>& learnt) const
 {
-    removePolyFromOccur(poly.usedVariables(), eq_idx);
+    for (size_t i = 0; i < learnt.size(); ++i)
+        learnt[i] = replacer->update(learnt[i]);
 }
 
 bool ANF::updateEquations(size_t eq_idx, const BoolePolynomial newpoly,
@@ -507,8 +532,8 @@ bool ANF::updateEquations(size_t eq_idx, const BoolePolynomial newpoly,
     BoolePolynomial& poly = eqs[eq_idx];
     BooleMonomial prev_used = poly.usedVariables();
 
-    const size_t check = eqs_hash.erase(poly.hash());
-    assert(check == 1);
+    const bool check = hashErase(poly);
+    assert(check);
     poly = newpoly;
 
     if (poly.isConstant()) {
@@ -523,8 +548,7 @@ bool ANF::updateEquations(size_t eq_idx, const BoolePolynomial newpoly,
             cout << "c    update remove equation " << eq_idx << endl;
         }
     } else {
-        auto ins = eqs_hash.insert(poly.hash());
-        if (!ins.second) { // already exist
+        if (!hashInsert(poly)) { // already exist
             poly = 0;      // remove it using empty
             empty_equations.push_back(eq_idx);
             if (config.verbosity >= 4) {
@@ -534,12 +558,9 @@ bool ANF::updateEquations(size_t eq_idx, const BoolePolynomial newpoly,
         }
     } // if ... else
 
-    BooleMonomial curr_used(poly.usedVariables());
-    BooleMonomial gcd = prev_used.GCD(curr_used);
-    prev_used /= gcd; // update remove list
-    curr_used /= gcd; // update insert list
-    removePolyFromOccur(prev_used, eq_idx);
-    addPolyToOccur(curr_used, eq_idx);
+    const BooleMonomial used = poly.usedVariables();
+    occur.update(eq_idx, prev_used, used);
+    eqs_shape[eq_idx] = EqShape{(uint32_t)used.deg(), poly.deg()};
     return true;
 }
 
@@ -550,14 +571,14 @@ bool ANF::propagate()
         cout << "c [ANF prop] Running ANF propagation..." << endl;
     }
 
-    //When a polynomial updates some var's definition, this set is updated. Used during simplify & addBoolePolynomial
-    unordered_set<uint32_t> updatedVars;
+    //When a polynomial updates some var's definition, the var is queued. Used during simplify & addBoolePolynomial
+    VarQueue updatedVars(occur.numVars());
     size_t updates = 0;
 
     // Always run through the new equations
     for (size_t eq_idx = new_equations_begin; eq_idx < eqs.size(); ++eq_idx) {
         // changes: replacer
-        updates += check_if_need_update(eqs[eq_idx], updatedVars);
+        updates += check_if_need_update(eq_idx, updatedVars);
     }
 
     if (config.verbosity >= 3) {
@@ -568,18 +589,33 @@ bool ANF::propagate()
     }
 
     std::vector<size_t> empty_equations;
-    const bool ret = propagate_iteratively(updatedVars, empty_equations);
+    size_t rewritten = 0;
+    const bool ret = propagate_iteratively(updatedVars, empty_equations,
+                                           rewritten);
 
     if (config.verbosity) {
-        cout << "c [ANF prop] Left eqs: " << eqs.size() << " T: " << std::fixed
-             << std::setprecision(2) << (cpuTime() - myTime) << endl;
+        const double T = cpuTime() - myTime;
+        cout << "c [ANF prop] Left eqs: " << size()
+             << " Rewritten eqs: " << rewritten << " (" << std::fixed
+             << std::setprecision(0) << rewritten / std::max(T, 1e-6)
+             << " eqs/s) T: " << std::setprecision(2) << T << endl;
+    }
+    if (config.verbosity >= 3) {
+        cout << "c  linear rows: " << linear.numRows()
+             << (linear.isFull() ? " (full)" : "") << endl;
+        checkOccur();
     }
     return ret;
 }
 
-bool ANF::propagate_iteratively(unordered_set<uint32_t>& updatedVars,
-                                std::vector<size_t>& empty_equations)
+bool ANF::propagate_iteratively(VarQueue& updatedVars,
+                                std::vector<size_t>& empty_equations,
+                                size_t& rewritten)
 {
+    // Equations of the current wave, each listed once
+    vector<char> dirty(eqs.size(), 0);
+    vector<size_t> wave;
+
     //Recursively update polynomials, while there is something to update
     bool timeout = (cpuTime() > config.maxTime);
     while (!updatedVars.empty() && !timeout) {
@@ -588,52 +624,63 @@ bool ANF::propagate_iteratively(unordered_set<uint32_t>& updatedVars,
                  << "number of variables to update: " << updatedVars.size()
                  << endl;
         }
-        // Make a copy of what variables to iterate through in this cycle
-        unordered_set<uint32_t> updatedVars_snapshot;
-        updatedVars.swap(updatedVars_snapshot);
-
-        for (unordered_set<uint32_t>::const_iterator pvar_idx =
-                 updatedVars_snapshot.begin();
-             pvar_idx != updatedVars_snapshot.end() && !timeout; ++pvar_idx) {
-            const uint32_t& var_idx = *pvar_idx;
-            assert(occur.size() > var_idx);
-            // We will remove and add stuff to occur, so iterate over a snapshot
-            const vector<size_t> occur_snapshot = occur[var_idx];
-            if (config.verbosity >= 5) {
-                cout << "c Updating variable " << var_idx << ' '
-                     << occur_snapshot.size() << endl;
+
+        // Vars updated while going through this wave go to the next one
+        wave.clear();
+        while (!updatedVars.empty()) {
+            const uint32_t var_idx = updatedVars.pop();
+            assert(occur.numVars() > var_idx);
+            if (value(var_idx) != l_Undef) {
+                fireImplications(var_idx, updatedVars);
+            }
+            if (linear.hasVar(var_idx)) {
+                feedLinear(var_idx, updatedVars);
             }
-            for (const size_t& eq_idx : occur_snapshot) {
-                assert(eqs.size() > eq_idx);
-                BoolePolynomial& poly = eqs[eq_idx];
-                if (config.verbosity >= 5) {
-                    cout << "c equation stats: " << poly.length() << ' '
-                         << poly.nUsedVariables() << ' ' << eq_idx << '/'
-                         << occur_snapshot.size() << ' ' << var_idx << '/'
-                         << updatedVars_snapshot.size() << ' ' << cpuTime()
-                         << endl;
+            occur.forEach(var_idx, [&](const size_t eq_idx) {
+                if (!dirty[eq_idx]) {
+                    dirty[eq_idx] = 1;
+                    wave.push_back(eq_idx);
                 }
+            });
+        }
+        if (config.verbosity >= 5) {
+            cout << "c Updating " << wave.size() << " equations" << endl;
+        }
 
-                if (config.verbosity >= 6) {
-                    cout << "c equation: " << poly << endl;
-                }
+        for (size_t i = 0; i < wave.size(); i++) {
+            const size_t eq_idx = wave[i];
+            dirty[eq_idx] = 0;
+            if (timeout) {
+                continue;
+            }
 
-                if (!(replacer->willUpdate(poly))) {
-                    continue;
-                }
+            assert(eqs.size() > eq_idx);
+            BoolePolynomial& poly = eqs[eq_idx];
+            if (config.verbosity >= 6) {
+                cout << "c equation: " << poly << endl;
+            }
 
-                if (!updateEquations(eq_idx, replacer->update(poly),
-                                     empty_equations)) {
-                    return false;
-                }
+            if (!(replacer->willUpdate(poly))) {
+                continue;
+            }
 
-                if (!poly.isConstant()) {
-                    check_if_need_update(poly,         // changes: replacer
-                                         updatedVars); // Add back to occur
-                }
-            } // for eq_idx
-            timeout = (cpuTime() > config.maxTime);
-        } //for var
+            if (!updateEquations(eq_idx, replacer->update(poly),
+                                 empty_equations)) {
+                // The equations zeroed so far must still be counted dead
+                removeEquations(empty_equations);
+                return false;
+            }
+            rewritten++;
+
+            if (!poly.isConstant()) {
+                check_if_need_update(eq_idx,       // changes: replacer
+                                     updatedVars); // Add back to occur
+            }
+
+            if ((i & 1023) == 1023) {
+                timeout = (cpuTime() > config.maxTime);
+            }
+        } // for eq_idx
         if (config.verbosity >= 4) {
             cout << "c  ..."
                  << "equations removed: " << empty_equations.size()
@@ -667,33 +714,13 @@ void ANF::checkSimplifiedPolysContainNoSetVars() const
 
 void ANF::removeEquations(std::vector<size_t>& eq2r)
 {
-    vector<std::pair<size_t, size_t> > remap(eqs.size());
-    for (size_t i = 0; i < remap.size(); ++i)
-        remap[i] = std::make_pair(i, i);
-
+    // The slots are kept as zero polynomials, so that the ids of the other
+    // equations stay valid. They are reclaimed once half of 'eqs' is dead.
     for (const size_t i : eq2r) {
-        const size_t ii = remap[i].second;
-        const BoolePolynomial& eq = eqs[ii];
-        assert(eq.isConstant() && eq.isZero());
-        if (ii == eqs.size() - 1)
-            eqs.pop_back();
-        else {
-            eqs[ii] = eqs.back();
-            eqs.pop_back();
-            size_t f = remap[eqs.size()].first;
-            remap[f].second = ii;
-            remap[ii].first = f;
-        }
-    }
-
-    //Go through each variable occurance
-    for (vector<size_t>& var_occur : occur) {
-        //The indexes of the equations have changed. Update them.
-        for (size_t& eq_idx : var_occur) {
-            eq_idx = remap[eq_idx].second;
-            assert(eq_idx < eqs.size());
-        }
+        assert(eqs[i].isConstant() && eqs[i].isZero());
+        numDead++;
     }
+    assert(numDead <= eqs.size());
 
     // bookkeeping and verbosity
     if (config.verbosity >= 3) {
@@ -701,13 +728,53 @@ void ANF::removeEquations(std::vector<size_t>& eq2r)
     }
 
     eq2r.clear();
+    if (numDead > 16 && numDead * 2 > eqs.size()) {
+        compact();
+    }
     new_equations_begin = eqs.size();
 }
 
+void ANF::compact()
+{
+    if (numDead == 0) {
+        return;
+    }
+
+    // Keep the order of the live equations
+    vector<size_t> newIdx(eqs.size());
+    size_t j = 0;
+    for (size_t i = 0; i < eqs.size(); ++i) {
+        newIdx[i] = j;
+        if (!eqs[i].isZero()) {
+            if (i != j) {
+                eqs[j] = eqs[i];
+                eqs_shape[j] = eqs_shape[i];
+            }
+            j++;
+        }
+    }
+    assert(j + numDead == eqs.size());
+
+    new_equations_begin = (new_equations_begin < eqs.size())
+                              ? newIdx[new_equations_begin]
+                              : j;
+    eqs.erase(eqs.begin() + j, eqs.end());
+    eqs_shape.resize(j);
+    occur.renumber(newIdx, eqs.size());
+    numDead = 0;
+
+    if (config.verbosity >= 3) {
+        cout << "c  compacted to " << eqs.size() << " eqs." << endl;
+    }
+}
+
 bool ANF::evaluate(const vector<lbool>& vals) const
 {
     bool ret = true;
     for (const BoolePolynomial& poly : eqs) {
+        if (poly.isZero()) {
+            continue;
+        }
         lbool lret = evaluatePoly(poly, vals);
         assert(lret != l_Undef);
 
@@ -734,10 +801,15 @@ bool ANF::evaluate(const vector<lbool>& vals) const
 
 void ANF::checkOccur() const
 {
-    for (const vector<size_t>& var_occur : occur) {
-        for (const size_t eq_idx : var_occur) {
+    for (uint32_t v = 0; v < occur.numVars(); v++) {
+        occur.forEach(v, [&](const size_t eq_idx) {
             assert(eq_idx < eqs.size());
-        }
+            assert(!eqs[eq_idx].isZero());
+        });
+    }
+    for (size_t i = 0; i < eqs.size(); i++) {
+        assert(eqs_shape[i].nvars == eqs[i].nUsedVariables());
+        assert(eqs[i].isZero() || eqs_shape[i].deg == eqs[i].deg());
     }
     if (config.verbosity >= 3) {
         cout << "Sanity check passed" << endl;
@@ -755,5 +827,5 @@ void ANF::get_solution_map(map<uint32_t, VarMap>& ret) const
 
 void ANF::print_solution_map(std::ofstream* ofs)
 {
-    replacer->print_solution_map(ofs);
+    replacer->print_solution_map(ofs, origVars);
 }
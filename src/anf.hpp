@@ -29,11 +29,17 @@ SOFTWARE.
 #include <iostream>
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+#include "anfutils.hpp"
 #include "configdata.hpp"
 #include "evaluator.hpp"
+#include "factoredpoly.hpp"
+#include "linearengine.hpp"
+#include "occurlist.hpp"
+#include "polyhashtable.hpp"
 #include "replacer.hpp"
 #include <polybori/polybori.h>
 
@@ -49,14 +55,63 @@ using std::vector;
 namespace BLib {
 
 class Replacer;
+class ANFParser;
+class BinaryWriter;
+class BinaryReader;
 
 struct anf_no_replacer_tag {
 };
 
+// FIFO of variables whose value or replacement changed, and whose
+// equations need updating. A variable is in the queue at most once.
+class VarQueue
+{
+   public:
+    explicit VarQueue(const size_t numVars) : queued(numVars, 0)
+    {
+    }
+
+    void push(const uint32_t var)
+    {
+        assert(var < queued.size());
+        if (!queued[var]) {
+            queued[var] = 1;
+            vars.push_back(var);
+        }
+    }
+
+    uint32_t pop()
+    {
+        assert(!empty());
+        const uint32_t var = vars[head++];
+        queued[var] = 0;
+        if (head == vars.size()) {
+            vars.clear();
+            head = 0;
+        }
+        return var;
+    }
+
+    bool empty() const
+    {
+        return head == vars.size();
+    }
+
+    size_t size() const
+    {
+        return vars.size() - head;
+    }
+
+   private:
+    vector<uint32_t> vars;
+    size_t head = 0;
+    vector<char> queued;
+};
+
 class ANF
 {
    public:
-    typedef unordered_set<BoolePolynomial::hash_type> eqs_hash_t;
+    typedef PolySet eqs_hash_t;
 
    public:
     ANF(const polybori::BoolePolyRing* _ring, ConfigData& _config);
@@ -64,13 +119,21 @@ class ANF
     ANF(const ANF&) = delete;
     ~ANF();
 
-    size_t readFile(const string& filename);
+    void readFile(const ANFParser& parser);
+    // Everything but the ring size, which is in the file header
+    void saveBinary(BinaryWriter& w) const;
+    void loadBinary(BinaryReader& r);
     bool propagate();
     inline vector<lbool> extendSolution(const vector<lbool>& solution) const;
     void printStats() const;
     void print_solution_map(std::ofstream* ofs);
     void get_solution_map(map<uint32_t, VarMap>& ret) const;
 
+    // Makes room for 'numEqs' more equations, in which each (v, n) pair of
+    // 'varCount' says variable 'v' occurs n times, ahead of adding them in bulk
+    void reserve(size_t numEqs,
+                 const vector<std::pair<uint32_t, size_t> >& varCount);
+
     // Returns true if polynomial is new and has been added
     bool addBoolePolynomial(const BoolePolynomial& poly);
     bool addLearntBoolePolynomial(const BoolePolynomial& poly);
@@ -89,29 +152,50 @@ class ANF
     size_t numMonoms() const;
     //size_t numUniqueMonoms(const vector<BoolePolynomial>& equations) const;
     inline bool hasPolynomial(const BoolePolynomial& p) const;
+    inline const FactoredPoly* getFactored(const BoolePolynomial& p) const;
     const BoolePolyRing& getRing() const;
+    // May contain zero polynomials in place of removed equations, unless
+    // compact() was called since the last propagation
     const vector<BoolePolynomial>& getEqs() const;
     inline const vector<lbool>& getFixedValues() const;
     inline const eqs_hash_t& getEqsHash(void) const;
-    const vector<vector<size_t> >& getOccur() const;
+
+    // While a snapshot is taken, the changes to the set of equations are
+    // recorded, so that the set at the time can be queried without a copy
+    void takeSnapshot();
+    void dropSnapshot();
+    bool inSnapshot(const BoolePolynomial& p) const;
+    const OccurList& getOccur() const;
     inline bool getOK() const;
     bool evaluate(const vector<lbool>& vals) const;
     void checkOccur() const;
     inline lbool value(const uint32_t var) const;
     inline Lit getReplaced(const uint32_t var) const;
     inline ANF& operator=(const ANF& other);
-    static size_t readFileForMaxVar(const std::string& filename);
     set<size_t> get_proj_set() const;
 
+    // Drops removed equations, renumbering the rest
+    void compact();
+
+    // Variables may have been renumbered when reading the file, this gives
+    // the original index of each. Empty if they were not renumbered.
+    inline const vector<uint32_t>& getOrigVars() const;
+    inline uint32_t getOrigVar(const uint32_t var) const;
+
    private:
-    bool propagate_iteratively(unordered_set<uint32_t>& updatedVars,
-                               std::vector<size_t>& empty_equations);
-    bool check_if_need_update(const BoolePolynomial& poly,
-                              unordered_set<uint32_t>& updatedVars);
-    void addPolyToOccur(const BooleMonomial& mono, size_t eq_idx);
-    void removePolyFromOccur(const BooleMonomial& mono, size_t eq_idx);
-    void addPolyToOccur(const BoolePolynomial& poly, size_t eq_idx);
-    void removePolyFromOccur(const BoolePolynomial& poly, size_t eq_idx);
+    bool propagate_iteratively(VarQueue& updatedVars,
+                               std::vector<size_t>& empty_equations,
+                               size_t& rewritten);
+    bool hashInsert(const BoolePolynomial& p);
+    bool hashErase(const BoolePolynomial& p);
+    bool check_if_need_update(size_t eq_idx, VarQueue& updatedVars);
+    bool check_two_vars(const BoolePolynomial& poly, VarQueue& updatedVars);
+    bool addBinary(Lit a, Lit b, VarQueue& updatedVars);
+    void setLit(Lit lit, VarQueue& updatedVars);
+    void fireImplications(uint32_t var, VarQueue& updatedVars);
+    bool addLinear(const vector<uint32_t>& vars, bool rhs,
+                   VarQueue& updatedVars);
+    void feedLinear(uint32_t var, VarQueue& updatedVars);
     void removeEquations(std::vector<size_t>& eq2r);
     bool updateEquations(size_t idx, const BoolePolynomial newpoly,
                          vector<size_t>& empty_equations);
@@ -129,13 +213,42 @@ class ANF
     // Independent variables
     set<size_t> proj_set;
 
+    // Original index of each variable, if renumbered
+    vector<uint32_t> origVars;
+
+    // Equations as they were given with brackets, by hash of their expanded
+    // form. Only valid while the equation is still around unchanged.
+    std::unordered_map<BoolePolynomial::hash_type,
+                       std::pair<BoolePolynomial, FactoredPoly> >
+        factored;
+
     //State
     vector<BoolePolynomial> eqs;
     eqs_hash_t eqs_hash;
+    bool snapshotOn = false;
+    PolySet snapAdded;   ///<not in eqs_hash at the snapshot
+    PolySet snapRemoved; ///<in eqs_hash at the snapshot, not any more
+    // Number of variables and degree of each equation
+    struct EqShape {
+        uint32_t nvars;
+        int deg;
+    };
+    vector<EqShape> eqs_shape;
     Replacer* replacer;
-    vector<vector<size_t> > occur; //occur[var] -> index of polys where the variable occurs
+    OccurList occur; //occur[var] -> index of polys where the variable occurs
+
+    // Binary clauses implied by equations, e.g. "x*y + x" gives x -> y.
+    // implied[lit.toInt()] holds the literals that follow once 'lit' holds,
+    // where Lit(v, false) holds if v is TRUE.
+    vector<vector<Lit> > implied;
+
+    // Linear equations of 3 or more variables, and the values and
+    // replacements of their variables
+    LinearEngine linear;
+    vector<char> linearFed; ///<1 if replacement of var was given, 2 if value
 
     size_t new_equations_begin = 0;
+    size_t numDead = 0; //removed equations still taking up a slot in 'eqs'
 
     friend std::ostream& operator<<(std::ostream& os, const ANF& anf);
 };
@@ -144,17 +257,24 @@ inline ANF::ANF(const ANF& other, const anf_no_replacer_tag)
     : ring(other.ring),
       config(other.config),
       comments(other.comments),
+      origVars(other.origVars),
+      factored(other.factored),
       eqs(other.eqs),
       eqs_hash(other.eqs_hash),
+      eqs_shape(other.eqs_shape),
       replacer(nullptr),
       occur(other.occur),
-      new_equations_begin(other.new_equations_begin)
+      implied(other.implied),
+      linear(other.linear),
+      linearFed(other.linearFed),
+      new_equations_begin(other.new_equations_begin),
+      numDead(other.numDead)
 {
 }
 
 inline size_t ANF::size() const
 {
-    return eqs.size();
+    return eqs.size() - numDead;
 }
 
 inline const BoolePolyRing& ANF::getRing() const
@@ -198,7 +318,16 @@ inline const ANF::eqs_hash_t& ANF::getEqsHash(void) const
 
 inline bool ANF::hasPolynomial(const BoolePolynomial& p) const
 {
-    return eqs_hash.find(p.hash()) != eqs_hash.end();
+    return eqs_hash.contains(p);
+}
+
+inline const FactoredPoly* ANF::getFactored(const BoolePolynomial& p) const
+{
+    const auto it = factored.find(p.hash());
+    if (it == factored.end() || it->second.first != p) {
+        return NULL;
+    }
+    return &it->second.second;
 }
 
 inline size_t ANF::getNumSimpleXors() const
@@ -210,7 +339,7 @@ inline size_t ANF::getNumSimpleXors() const
     return num;
 }
 
-inline const vector<vector<size_t> >& ANF::getOccur() const
+inline const OccurList& ANF::getOccur() const
 {
     return occur;
 }
@@ -224,11 +353,14 @@ inline std::ostream& operator<<(std::ostream& os, const ANF& anf)
 
     // Print equations
     for (const BoolePolynomial& poly : anf.eqs) {
-        os << poly;
+        if (poly.isZero()) {
+            continue;
+        }
+        print_poly(os, poly, anf.origVars);
         os << endl;
     }
 
-    os << *(anf.replacer);
+    anf.replacer->print(os, anf.origVars);
     return os;
 }
 
@@ -286,6 +418,16 @@ Lit ANF::getReplaced(const uint32_t var) const
     return replacer->getReplaced(var);
 }
 
+const vector<uint32_t>& ANF::getOrigVars() const
+{
+    return origVars;
+}
+
+uint32_t ANF::getOrigVar(const uint32_t var) const
+{
+    return origVars.empty() ? var : origVars[var];
+}
+
 const vector<lbool>& ANF::getFixedValues() const
 {
     return replacer->getValues();
@@ -295,8 +437,16 @@ ANF& ANF::operator=(const ANF& other)
 {
     //assert(updatedVars.empty() && other.updatedVars.empty());
     eqs = other.eqs;
+    eqs_shape = other.eqs_shape;
+    origVars = other.origVars;
+    factored = other.factored;
     *replacer = *other.replacer;
     occur = other.occur;
+    implied = other.implied;
+    linear = other.linear;
+    linearFed = other.linearFed;
+    new_equations_begin = other.new_equations_begin;
+    numDead = other.numDead;
     return *this;
 }
 
@@ -0,0 +1,135 @@
+/*****************************************************************************
+Copyright (C) 2016  Security Research Labs
+Copyright (C) 2018  Mate Soos, Davin Choo, Kian Ming A. Chai, DSO National Laboratories
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***********************************************/
+
+#include "anfbinary.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+using std::cout;
+using std::endl;
+
+USING_NAMESPACE_PBORI
+using namespace BLib;
+
+void BinaryWriter::writePoly(const BoolePolynomial& poly)
+{
+    writeVarint(poly.length());
+    for (BoolePolynomial::const_iterator it = poly.begin(), end = poly.end();
+         it != end; it++) {
+        writeVarint(it->deg());
+        uint32_t prev = 0;
+        for (BooleMonomial::const_iterator v = it->begin(), vend = it->end();
+             v != vend; v++) {
+            writeVarint(*v - prev);
+            prev = *v;
+        }
+    }
+}
+
+void BinaryWriter::writeHeader(const uint64_t numVars)
+{
+    buf.append(binary_anf_magic, sizeof(binary_anf_magic));
+    writeVarint(binary_anf_version);
+    writeVarint(numVars);
+}
+
+void BinaryWriter::saveToFile(const std::string& fname) const
+{
+    std::ofstream ofs(fname, std::ios::binary);
+    if (!ofs) {
+        std::cerr << "c Error opening file \"" << fname << "\" for writing\n";
+        exit(-1);
+    }
+    ofs.write(buf.data(), buf.size());
+    if (!ofs) {
+        std::cerr << "c Error writing file \"" << fname << "\"\n";
+        exit(-1);
+    }
+}
+
+BinaryReader::BinaryReader(const std::string& _fname)
+    : fname(_fname), file(_fname)
+{
+    at = (const uint8_t*)file.data();
+    end = at + file.size();
+}
+
+void BinaryReader::truncated() const
+{
+    cout << "ERROR: binary ANF file \"" << fname << "\" is truncated or corrupt"
+         << endl;
+    exit(-1);
+}
+
+uint64_t BinaryReader::readHeader()
+{
+    if ((size_t)(end - at) < sizeof(binary_anf_magic) ||
+        memcmp(at, binary_anf_magic, sizeof(binary_anf_magic)) != 0) {
+        cout << "ERROR: \"" << fname << "\" is not a binary ANF file" << endl;
+        exit(-1);
+    }
+    at += sizeof(binary_anf_magic);
+
+    const uint64_t version = readVarint();
+    if (version != binary_anf_version) {
+        cout << "ERROR: binary ANF file \"" << fname << "\" has version "
+             << version << ", but only version " << binary_anf_version
+             << " is supported" << endl;
+        exit(-1);
+    }
+    numVars = readVarint();
+    return numVars;
+}
+
+std::string BinaryReader::readString()
+{
+    const uint64_t len = readVarint();
+    if ((uint64_t)(end - at) < len) {
+        truncated();
+    }
+    std::string ret((const char*)at, len);
+    at += len;
+    return ret;
+}
+
+BoolePolynomial BinaryReader::readPoly(PolynomialBuilder& builder)
+{
+    const uint64_t numMonoms = readVarint();
+    for (uint64_t i = 0; i < numMonoms; i++) {
+        const uint64_t deg = readVarint();
+        monom.clear();
+        uint64_t v = 0;
+        for (uint64_t j = 0; j < deg; j++) {
+            v += readVarint();
+            if (v >= numVars) {
+                truncated();
+            }
+            monom.push_back(v);
+        }
+        builder.addMonomial(monom.data(), monom.data() + monom.size());
+    }
+    return builder.build();
+}
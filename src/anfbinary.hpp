@@ -0,0 +1,110 @@
+/*****************************************************************************
+Copyright (C) 2016  Security Research Labs
+Copyright (C) 2018  Mate Soos, Davin Choo, Kian Ming A. Chai, DSO National Laboratories
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***********************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "anfutils.hpp"
+#include "filereader.hpp"
+#include <polybori/polybori.h>
+
+namespace BLib {
+
+// Binary ANF files start with this, followed by the format version and the
+// number of variables, all as varints. The sections after that are written
+// and read by ANF::saveBinary()/loadBinary() and by Bosphorus.
+static const char binary_anf_magic[8] = {'B', 'O', 'S', 'P', 'H', 'A', 'N', 'F'};
+static const uint64_t binary_anf_version = 1;
+
+class BinaryWriter
+{
+   public:
+    void writeVarint(uint64_t v)
+    {
+        while (v >= 0x80) {
+            buf.push_back((char)(v | 0x80));
+            v >>= 7;
+        }
+        buf.push_back((char)v);
+    }
+
+    void writeString(const std::string& s)
+    {
+        writeVarint(s.size());
+        buf.append(s);
+    }
+
+    // Monomials as their number of variables, then the variable indices
+    // in increasing order, each but the first as a difference
+    void writePoly(const polybori::BoolePolynomial& poly);
+
+    void writeHeader(uint64_t numVars);
+    void saveToFile(const std::string& fname) const;
+
+   private:
+    std::string buf;
+};
+
+class BinaryReader
+{
+   public:
+    explicit BinaryReader(const std::string& fname);
+
+    uint64_t readVarint()
+    {
+        uint64_t v = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            if (at == end) {
+                truncated();
+            }
+            const uint8_t b = *at++;
+            v |= (uint64_t)(b & 0x7f) << shift;
+            if ((b & 0x80) == 0) {
+                return v;
+            }
+        }
+        truncated();
+        return 0;
+    }
+
+    std::string readString();
+    polybori::BoolePolynomial readPoly(PolynomialBuilder& builder);
+
+    // Reads the header, returns the number of variables
+    uint64_t readHeader();
+
+   private:
+    void truncated() const;
+
+    const std::string fname;
+    MappedFile file;
+    const uint8_t* at;
+    const uint8_t* end;
+    uint64_t numVars = 0;
+    std::vector<uint32_t> monom;
+};
+
+}
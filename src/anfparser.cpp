@@ -0,0 +1,701 @@
+/*****************************************************************************
+Copyright (C) 2016  Security Research Labs
+Copyright (C) 2018  Mate Soos, Davin Choo, Kian Ming A. Chai, DSO National Laboratories
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***********************************************/
+
+#include "anfparser.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "filereader.hpp"
+
+using std::cout;
+using std::endl;
+
+using namespace BLib;
+
+// Below this many bytes per thread, starting threads is not worth it
+static const size_t min_chunk_size = 1 << 20;
+
+void ANFParser::parseFile(const string& filename, unsigned numThreads,
+                          bool renumber)
+{
+    read_lines(filename, [&](const char* beg, const char* end) {
+        parseChunks(beg, end, numThreads);
+    });
+    finish(renumber);
+}
+
+void ANFParser::parseChunks(const char* beg, const char* end,
+                            unsigned numThreads)
+{
+    const size_t len = end - beg;
+    numThreads = std::min<size_t>(numThreads, len / min_chunk_size);
+    if (numThreads <= 1) {
+        parseBuffer(beg, end);
+        return;
+    }
+
+    // Cut roughly equal pieces, each ending right after a newline
+    vector<const char*> cuts;
+    cuts.push_back(beg);
+    for (unsigned i = 1; i < numThreads; i++) {
+        const char* at = std::max(beg + len / numThreads * i, cuts.back());
+        const char* eol = (const char*)memchr(at, '\n', end - at);
+        if (eol == NULL) {
+            break;
+        }
+        cuts.push_back(eol + 1);
+    }
+    cuts.push_back(end);
+
+    // The ring is not thread-safe, but the parsers never touch it
+    vector<ANFParser> parts(cuts.size() - 1);
+    vector<std::thread> threads;
+    for (size_t i = 1; i < parts.size(); i++) {
+        threads.push_back(std::thread(&ANFParser::parseBuffer, &parts[i],
+                                      cuts[i], cuts[i + 1]));
+    }
+    parts[0].parseBuffer(cuts[0], cuts[1]);
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    // Merge in file order, so polynomials are added as if read sequentially
+    for (const ANFParser& part : parts) {
+        append(part);
+    }
+}
+
+void ANFParser::append(const ANFParser& other)
+{
+    const size_t varOffs = vars.size();
+    const size_t monoOffs = monoms.size();
+    vars.insert(vars.end(), other.vars.begin(), other.vars.end());
+    for (const size_t m : other.monoms) {
+        monoms.push_back(m + varOffs);
+    }
+    const size_t polyOffs = polys.size();
+    for (const size_t p : other.polys) {
+        polys.push_back(p + monoOffs);
+    }
+    for (const auto& f : other.factored) {
+        factored.push_back(std::make_pair(f.first + polyOffs, f.second));
+    }
+    comments.insert(comments.end(), other.comments.begin(),
+                    other.comments.end());
+
+    if (other.proj_set_found) {
+        if (proj_set_found) {
+            cout << "ERROR: you have more than one 'c p show' in your ANF file, i.e. more than one projection set. This is not allowed." << endl;
+            exit(-1);
+        }
+        proj_set_found = true;
+        proj_set = other.proj_set;
+    }
+    maxVar = std::max(maxVar, other.maxVar);
+}
+
+void ANFParser::parseBuffer(const char* beg, const char* end)
+{
+    while (beg < end) {
+        const char* eol = (const char*)memchr(beg, '\n', end - beg);
+        if (eol == NULL) {
+            parseLine(beg, end);
+            break;
+        }
+        parseLine(beg, eol);
+        beg = eol + 1;
+    }
+}
+
+void ANFParser::parseComment(const string& temp)
+{
+    comments.push_back(temp);
+    std::istringstream iss(temp);
+    std::string txt;
+    iss >> txt;
+    if (txt != "c") return;
+    iss >> txt;
+    if (txt != "p") return;
+    iss >> txt;
+    if (txt != "show") return;
+    if (proj_set_found) {
+        cout << "ERROR: you have more than one 'c p show' in your ANF file, i.e. more than one projection set. This is not allowed." << endl;
+        exit(-1);
+    }
+    proj_set_found = true;
+    while(true) {
+        iss >> txt;
+        if (txt == "END") break;
+        int i;
+        if(sscanf(txt.c_str(), "x%d", &i) != 1) {
+            cout << "ERROR: in projection set, there is a malformed value, it should be xNUM, but it's: '" << txt << "'" << endl;
+            exit(-1);
+        }
+        if (i < 0) {
+            cout << "ERROR: projection set must ONLY contain positive integers" << endl;
+            exit(-1);
+        }
+        if (proj_set.find(i) != proj_set.end()) {
+            cout << "ERROR: you are either adding '" << i << "' twice into the projection set, or your forgot to type 'END' at the end of the projection set" << endl;
+            exit(-1);
+        }
+        proj_set.insert(i);
+    }
+}
+
+void ANFParser::parseLine(const char* beg, const char* end)
+{
+    // Empty lines are ignored
+    if (beg == end) {
+        return;
+    }
+
+    // Save comments
+    if (*beg == 'c') {
+        parseComment(string(beg, end));
+        return;
+    }
+
+    // Brackets need the full parser, plain sums of monomials don't
+    if (memchr(beg, '(', end - beg) != NULL ||
+        memchr(beg, ')', end - beg) != NULL) {
+        parseFactoredLine(beg, end);
+        return;
+    }
+
+    const size_t polyStart = monoms.size();
+    vector<vector<uint32_t> > desc;
+    bool startOfVar = false;
+    bool readInVar = false;
+    bool readInDesc = false;
+
+    size_t var = 0;
+    vector<uint32_t> m;
+    auto addMonom = [&](const bool toDesc) {
+        m.push_back(var);
+        if (toDesc) {
+            desc.push_back(m);
+        } else {
+            monoms.push_back(vars.size());
+            vars.insert(vars.end(), m.begin(), m.end());
+        }
+    };
+
+    for (const char* at = beg; at != end; at++) {
+        const char c = *at;
+
+        //Handle description separator ','
+        if (c == ',') {
+            if (readInVar) {
+                addMonom(false);
+            }
+
+            startOfVar = false;
+            readInVar = false;
+            var = 0;
+            m.clear();
+            readInDesc = true;
+            continue;
+        }
+
+        //Space means end of variable
+        if (c == ' ') {
+            if (startOfVar && !readInVar) {
+                cout << "x is not followed by number at this line : \""
+                     << string(beg, end) << "\"" << endl;
+                exit(-1);
+            }
+            startOfVar = false;
+            continue;
+        }
+
+        if (c == 'x' || c == 'X') {
+            startOfVar = true;
+            readInVar = false;
+            continue;
+        }
+
+        //Handle constant '1', which is the empty monomial.
+        //The constant of the description is irrelevant.
+        if (c == '1' && !startOfVar) {
+            if (!readInDesc) {
+                monoms.push_back(vars.size());
+            }
+            readInVar = false;
+            continue;
+        }
+
+        //Handle constant '0'
+        if (c == '0' && !startOfVar) {
+            readInVar = false;
+            continue;
+        }
+
+        if (c == '+') {
+            if (readInVar) {
+                addMonom(readInDesc);
+            }
+
+            startOfVar = false;
+            readInVar = false;
+            var = 0;
+            m.clear();
+            continue;
+        }
+
+        if (c == '*') {
+            if (!readInVar) {
+                cout << "ERROR: No variable before \"*\" in equation: \""
+                     << string(beg, end) << "\"" << endl;
+                exit(-1);
+            }
+
+            //Multiplying current var into monomial
+            m.push_back(var);
+
+            startOfVar = false;
+            readInVar = false;
+            var = 0;
+            continue;
+        }
+
+        //Deal with carriage return. Thanks Windows!
+        if (c == 13) {
+            continue;
+        }
+
+        //At this point, only numbers are valid
+        if (c < '0' || c > '9') {
+            cout << "ERROR: Unknown character 0x" << (int)c
+                 << " in equation: " << string(beg, end) << "\"" << endl;
+            exit(-1);
+        }
+
+        if (!startOfVar) {
+            cout << "ERROR: Value of variable is BEFORE \"x\" in the equation: \""
+                 << string(beg, end) << "\"" << endl;
+            exit(-1);
+        }
+        readInVar = true;
+        var *= 10;
+        var += c - '0';
+
+        //This variable will be used, no matter what, so use it as max
+        maxVar = std::max(maxVar, var);
+    }
+
+    //If variable was being built up when the line ended, add it
+    if (readInVar) {
+        addMonom(readInDesc);
+    }
+
+    checkDescription(desc, beg, end);
+
+    if (monoms.size() > polyStart) {
+        polys.push_back(polyStart);
+    }
+}
+
+namespace {
+
+// Recursive descent over a single line with brackets:
+//   line   := expr [',' expr]
+//   expr   := term ('+' term)*
+//   term   := factor ('*' factor)*
+//   factor := 'x' NUM | 'x(' NUM ')' | '(' expr ')' | '0' | '1'
+// A bracket that holds a single monomial is merged into the enclosing term,
+// so e.g. "x(1)*x(2)" is not considered factored.
+class LineParser
+{
+   public:
+    LineParser(const char* _beg, const char* _end, size_t& _maxVar)
+        : beg(_beg), end(_end), at(_beg), maxVar(_maxVar)
+    {
+    }
+
+    // Returns false if there is no description after a ','
+    bool parse(FactoredPoly& eq, FactoredPoly& desc)
+    {
+        parseExpr(eq);
+        bool hasDesc = false;
+        if (peek() == ',') {
+            at++;
+            parseExpr(desc);
+            hasDesc = true;
+        }
+        if (peek() == ')') {
+            error("ERROR: close bracket but no start bracket?");
+        }
+        if (peek() != 0) {
+            unexpected();
+        }
+        return hasDesc;
+    }
+
+   private:
+    // Next non-space character, 0 at the end of the line
+    char peek()
+    {
+        //Deal with carriage return. Thanks Windows!
+        while (at != end && (*at == ' ' || *at == 13)) {
+            at++;
+        }
+        return (at == end) ? 0 : *at;
+    }
+
+    size_t parseExpr(FactoredPoly& fp)
+    {
+        const size_t idx = fp.nodes.size();
+        fp.nodes.push_back(FactoredPoly::Node());
+
+        FactoredPoly::Node node;
+        while (true) {
+            FactoredPoly::Term t;
+            if (parseTerm(fp, t)) {
+                if (t.vars.empty() && t.subs.empty()) {
+                    node.constant ^= true;
+                } else {
+                    node.terms.push_back(std::move(t));
+                }
+            }
+            if (peek() != '+') {
+                break;
+            }
+            at++;
+        }
+        fp.nodes[idx] = std::move(node);
+        return idx;
+    }
+
+    // Returns false if the term is zero
+    bool parseTerm(FactoredPoly& fp, FactoredPoly::Term& t)
+    {
+        bool nonzero = true;
+        while (true) {
+            nonzero &= parseFactor(fp, t);
+            if (peek() != '*') {
+                break;
+            }
+            at++;
+        }
+        return nonzero;
+    }
+
+    // Multiplies the factor into 't'. Returns false if the factor is zero.
+    bool parseFactor(FactoredPoly& fp, FactoredPoly::Term& t)
+    {
+        const char c = peek();
+        if (c == 'x' || c == 'X') {
+            at++;
+            const bool bracket = (at != end && *at == '(');
+            if (bracket) {
+                at++;
+            }
+            if (at == end || *at < '0' || *at > '9') {
+                error("x is not followed by number at this line");
+            }
+            t.vars.push_back(parseNumber());
+            if (bracket) {
+                if (peek() != ')') {
+                    error("ERROR: end of line but bracket not closed");
+                }
+                at++;
+            }
+            return true;
+        }
+
+        if (c == '(') {
+            at++;
+            const size_t sub = parseExpr(fp);
+            if (peek() != ')') {
+                error("ERROR: end of line but bracket not closed");
+            }
+            at++;
+            return mergeSub(fp, sub, t);
+        }
+
+        if (c >= '0' && c <= '9') {
+            const size_t val = parseNumber(false);
+            if (val > 1) {
+                error("ERROR: Value of variable is BEFORE \"x\" in the equation");
+            }
+            return val == 1;
+        }
+
+        if (c == '*') {
+            error("ERROR: No variable before \"*\" in equation");
+        }
+        if (c == ')') {
+            error("ERROR: close bracket but no start bracket?");
+        }
+        unexpected();
+        return false;
+    }
+
+    // Brackets around a constant or a single monomial are dropped
+    bool mergeSub(FactoredPoly& fp, const size_t sub, FactoredPoly::Term& t)
+    {
+        FactoredPoly::Node& n = fp.nodes[sub];
+        if (n.terms.size() > 1 || (n.terms.size() == 1 && n.constant)) {
+            t.subs.push_back(sub);
+            return true;
+        }
+
+        bool nonzero = n.constant;
+        if (n.terms.size() == 1) {
+            FactoredPoly::Term& inner = n.terms[0];
+            t.vars.insert(t.vars.end(), inner.vars.begin(), inner.vars.end());
+            t.subs.insert(t.subs.end(), inner.subs.begin(), inner.subs.end());
+            nonzero = true;
+        }
+        n.terms.clear();
+        n.constant = false;
+        if (sub + 1 == fp.nodes.size()) {
+            fp.nodes.pop_back();
+        }
+        return nonzero;
+    }
+
+    uint32_t parseNumber(const bool isVar = true)
+    {
+        size_t val = 0;
+        while (at != end && *at >= '0' && *at <= '9') {
+            val = val * 10 + (*at - '0');
+            at++;
+        }
+        if (isVar) {
+            maxVar = std::max(maxVar, val);
+        }
+        return val;
+    }
+
+    void unexpected()
+    {
+        // A trailing operator runs into the end of the line
+        if (at == end) {
+            error("ERROR: unexpected end of line in equation");
+        }
+        cout << "ERROR: Unknown character 0x" << (int)*at
+             << " in equation: " << string(beg, end) << "\"" << endl;
+        exit(-1);
+    }
+
+    void error(const char* msg)
+    {
+        cout << msg << ": \"" << string(beg, end) << "\"" << endl;
+        exit(-1);
+    }
+
+    const char* const beg;
+    const char* const end;
+    const char* at;
+    size_t& maxVar;
+};
+
+// Multiplies out a (small) node into monomials, constants included
+void expand_monomials(const FactoredPoly& fp, const size_t node,
+                      vector<vector<uint32_t> >& out)
+{
+    const FactoredPoly::Node& n = fp.nodes[node];
+    if (n.constant) {
+        out.push_back(vector<uint32_t>());
+    }
+    for (const FactoredPoly::Term& t : n.terms) {
+        vector<vector<uint32_t> > prod(1, t.vars);
+        for (const size_t sub : t.subs) {
+            vector<vector<uint32_t> > subMonoms;
+            expand_monomials(fp, sub, subMonoms);
+            vector<vector<uint32_t> > next;
+            for (const vector<uint32_t>& a : prod) {
+                for (const vector<uint32_t>& b : subMonoms) {
+                    next.push_back(a);
+                    next.back().insert(next.back().end(), b.begin(), b.end());
+                }
+            }
+            prod.swap(next);
+        }
+        out.insert(out.end(), prod.begin(), prod.end());
+    }
+}
+
+}
+
+void ANFParser::parseFactoredLine(const char* beg, const char* end)
+{
+    FactoredPoly eq;
+    FactoredPoly descPoly;
+    LineParser lp(beg, end, maxVar);
+    const bool hasDesc = lp.parse(eq, descPoly);
+
+    //The constant of the description is irrelevant
+    vector<vector<uint32_t> > desc;
+    if (hasDesc) {
+        expand_monomials(descPoly, 0, desc);
+        desc.erase(std::remove_if(desc.begin(), desc.end(),
+                                  [](const vector<uint32_t>& m) {
+                                      return m.empty();
+                                  }),
+                   desc.end());
+    }
+    checkDescription(desc, beg, end);
+
+    const size_t polyStart = monoms.size();
+    if (eq.isFactored()) {
+        polys.push_back(polyStart);
+        factored.push_back(std::make_pair(polys.size() - 1, std::move(eq)));
+        return;
+    }
+
+    const FactoredPoly::Node& root = eq.nodes[0];
+    if (root.constant) {
+        monoms.push_back(vars.size());
+    }
+    for (const FactoredPoly::Term& t : root.terms) {
+        monoms.push_back(vars.size());
+        vars.insert(vars.end(), t.vars.begin(), t.vars.end());
+    }
+    if (monoms.size() > polyStart) {
+        polys.push_back(polyStart);
+    }
+}
+
+// After the comma, only a single-var monomial (and a constant) is allowed.
+// Identical monomials cancel out, so normalize before counting.
+void ANFParser::checkDescription(vector<vector<uint32_t> >& desc,
+                                 const char* beg, const char* end) const
+{
+    if (desc.empty()) {
+        return;
+    }
+
+    for (vector<uint32_t>& mono : desc) {
+        std::sort(mono.begin(), mono.end());
+        mono.erase(std::unique(mono.begin(), mono.end()), mono.end());
+    }
+    std::sort(desc.begin(), desc.end());
+
+    size_t realTermsSize = 0;
+    const vector<uint32_t>* term = NULL;
+    for (size_t i = 0; i < desc.size();) {
+        size_t j = i;
+        while (j < desc.size() && desc[j] == desc[i]) {
+            j++;
+        }
+        if ((j - i) % 2 == 1) {
+            realTermsSize++;
+            term = &desc[i];
+        }
+        i = j;
+    }
+
+    const char* comma = (const char*)memchr(beg, ',', end - beg);
+    const string line(beg, end);
+    if (realTermsSize > 1) {
+        cout << "ERROR!" << endl
+             << "After the comma, only a monomial is supported (not an "
+                "equation)"
+             << endl
+             << "But You gave: " << string(comma + 1, end) << " on line: '"
+             << line << "'" << endl;
+        exit(-1);
+    }
+
+    if (realTermsSize == 1 && term->size() > 1) {
+        cout << "ERROR! " << endl
+             << "After the comma, only a single-var monomial is supported "
+                "(no multi-var monomial)"
+             << endl
+             << "You gave: " << string(comma + 1, end) << " on line: "
+             << line << endl;
+        exit(-1);
+    }
+}
+
+void ANFParser::finish(const bool renumber)
+{
+    for(const auto& v: proj_set) {
+        if (v > maxVar) {
+            cout << "ERROR: the maximum variable in the ANF was: x" << maxVar << " but your projection set contains var x" << v << " which is higher. This is wrong." << endl;
+            exit(-1);
+        }
+    }
+
+    if (renumber) {
+        renumberVars();
+    }
+
+    if (proj_set_found == false) {
+        cout << "c setting projection set to ALL variables since we didn't find a 'c p show ... END'" << endl;
+        for(uint32_t i = 0; i <= maxVar; i++) {
+            proj_set.insert(i);
+        }
+    }
+}
+
+// Variables keep their relative order, so the polynomials keep the shape
+// (and the monomial order) they would have had with the original indices
+void ANFParser::renumberVars()
+{
+    origVars = vars;
+    for (const auto& f : factored) {
+        for (const FactoredPoly::Node& n : f.second.nodes) {
+            for (const FactoredPoly::Term& t : n.terms) {
+                origVars.insert(origVars.end(), t.vars.begin(), t.vars.end());
+            }
+        }
+    }
+    origVars.insert(origVars.end(), proj_set.begin(), proj_set.end());
+    std::sort(origVars.begin(), origVars.end());
+    origVars.erase(std::unique(origVars.begin(), origVars.end()),
+                   origVars.end());
+
+    auto dense = [&](const uint32_t v) -> uint32_t {
+        return std::lower_bound(origVars.begin(), origVars.end(), v) -
+               origVars.begin();
+    };
+    for (uint32_t& v : vars) {
+        v = dense(v);
+    }
+    for (auto& f : factored) {
+        for (FactoredPoly::Node& n : f.second.nodes) {
+            for (FactoredPoly::Term& t : n.terms) {
+                for (uint32_t& v : t.vars) {
+                    v = dense(v);
+                }
+            }
+        }
+    }
+    set<size_t> dense_proj_set;
+    for (const size_t v : proj_set) {
+        dense_proj_set.insert(dense(v));
+    }
+    proj_set.swap(dense_proj_set);
+
+    maxVar = origVars.empty() ? 0 : origVars.size() - 1;
+}
@@ -0,0 +1,142 @@
+/*****************************************************************************
+Copyright (C) 2016  Security Research Labs
+Copyright (C) 2018  Mate Soos, Davin Choo, Kian Ming A. Chai, DSO National Laboratories
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***********************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "factoredpoly.hpp"
+
+using std::set;
+using std::string;
+using std::vector;
+
+namespace BLib {
+
+// Tokenizes an ANF file in a single pass into a ring-independent
+// representation. Monomials are stored as arrays of variable indices, the
+// empty monomial being the constant 1. Once the whole input has been seen,
+// getMaxVar() tells how large the ring must be, and ANF::readFile() builds
+// the polynomials from here without touching the file again.
+class ANFParser
+{
+   public:
+    // With numThreads > 1, large files are split at line boundaries and the
+    // pieces are parsed in parallel. The result is the same either way.
+    // Compressed files (gzip, xz, zstd) are decompressed on the fly.
+    // With renumber, the variables used are mapped to 0..N-1, see
+    // getOrigVars().
+    void parseFile(const string& filename, unsigned numThreads = 1,
+                   bool renumber = false);
+
+    // Parse a buffer of complete lines, as they appear in the file
+    void parseBuffer(const char* beg, const char* end);
+
+    // Call once all input has been parsed
+    void finish(bool renumber = false);
+
+    size_t getMaxVar() const
+    {
+        return maxVar;
+    }
+
+    size_t getNumPolys() const
+    {
+        return polys.size();
+    }
+
+    // Monomials of polynomial 'p' are [polyBegin(p), polyEnd(p))
+    size_t polyBegin(size_t p) const
+    {
+        return polys[p];
+    }
+
+    size_t polyEnd(size_t p) const
+    {
+        return (p + 1 < polys.size()) ? polys[p + 1] : monoms.size();
+    }
+
+    // Variables of monomial 'm' are [monoBegin(m), monoEnd(m))
+    const uint32_t* monoBegin(size_t m) const
+    {
+        return vars.data() + monoms[m];
+    }
+
+    const uint32_t* monoEnd(size_t m) const
+    {
+        return vars.data() +
+               ((m + 1 < monoms.size()) ? monoms[m + 1] : vars.size());
+    }
+
+    // Polynomials given with brackets, e.g. (x1 + x2)*(x3 + 1), are not
+    // expanded here: they have no monomials, and are listed here instead,
+    // in increasing order of polynomial index
+    const vector<std::pair<size_t, FactoredPoly> >& getFactored() const
+    {
+        return factored;
+    }
+
+    const vector<string>& getComments() const
+    {
+        return comments;
+    }
+
+    const set<size_t>& getProjSet() const
+    {
+        return proj_set;
+    }
+
+    // After renumbering, the original index of each variable, in increasing
+    // order. Empty if the variables were not renumbered.
+    const vector<uint32_t>& getOrigVars() const
+    {
+        return origVars;
+    }
+
+   private:
+    void parseChunks(const char* beg, const char* end, unsigned numThreads);
+    void append(const ANFParser& other);
+    void parseLine(const char* beg, const char* end);
+    void parseFactoredLine(const char* beg, const char* end);
+    void parseComment(const string& line);
+    void renumberVars();
+    void checkDescription(vector<vector<uint32_t> >& desc, const char* beg,
+                          const char* end) const;
+
+    vector<uint32_t> vars;  ///<variables of all monomials, concatenated
+    vector<size_t> monoms;  ///<monoms[m]: start of monomial 'm' in 'vars'
+    vector<size_t> polys;   ///<polys[p]: first monomial of polynomial 'p'
+    vector<std::pair<size_t, FactoredPoly> > factored; ///<(poly index, form)
+
+    vector<string> comments;
+    set<size_t> proj_set;
+    bool proj_set_found = false;
+    size_t maxVar = 0;
+    vector<uint32_t> origVars;
+};
+
+}
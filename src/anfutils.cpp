@@ -20,6 +20,7 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 ***********************************************/
 
+#include <algorithm>
 #include <iostream>
 #include <unordered_set>
 
@@ -108,9 +109,68 @@ double BLib::do_sample_and_clone(const uint32_t verbosity,
     return log2uniquesz;
 }
 
+// substitute() for a polynomial of degree at most 2 and a linear 'to_poly',
+// on the terms rather than with ZDD division and multiplication
+static void substitute_quadratic(const uint32_t from,
+                                 const BoolePolynomial& to_poly,
+                                 BoolePolynomial& poly)
+{
+    vector<uint32_t> to;
+    bool toOne = false;
+    for (const BooleMonomial& mono : to_poly) {
+        if (mono.isOne()) {
+            toOne = true;
+        }
+        for (const uint32_t v : mono) {
+            to.push_back(v);
+        }
+    }
+
+    PolynomialBuilder builder(poly.ring());
+    bool found = false;
+    for (const BooleMonomial& mono : poly) {
+        uint32_t vars[2];
+        size_t n = 0;
+        bool hasFrom = false;
+        for (const uint32_t v : mono) {
+            if (v == from) {
+                hasFrom = true;
+            } else {
+                assert(n < 2);
+                vars[n++] = v;
+            }
+        }
+        if (!hasFrom) {
+            builder.addMonomial(vars, vars + n);
+            continue;
+        }
+
+        // from*rest becomes to_poly*rest
+        found = true;
+        assert(n < 2);
+        for (const uint32_t t : to) {
+            vars[n] = t;
+            builder.addMonomial(vars, vars + n + 1);
+        }
+        if (toOne) {
+            builder.addMonomial(vars, vars + n);
+        }
+    }
+
+    // `from_var` does not occur in `poly`, so just keep `poly` as it is.
+    if (found) {
+        poly = builder.build();
+    }
+}
+
 void BLib::substitute(const BooleVariable& from_var,
                       const BoolePolynomial& to_poly, BoolePolynomial& poly)
 {
+    if (poly.deg() <= 2 && to_poly.deg() <= 1) {
+        substitute_quadratic(from_var.index(), to_poly, poly);
+        return;
+    }
+
     BoolePolynomial quotient = poly / from_var;
 
     if (quotient.isZero()) {
@@ -131,3 +191,207 @@ void BLib::substitute(const BooleVariable& from_var,
     }
     swap(quotient, poly); // because we are returning poly
 }
+
+void PolynomialBuilder::addMonomial(const uint32_t* beg, const uint32_t* end)
+{
+    const size_t at = vars.size();
+    vars.insert(vars.end(), beg, end);
+    std::sort(vars.begin() + at, vars.end());
+    vars.erase(std::unique(vars.begin() + at, vars.end()), vars.end());
+    terms.push_back(make_pair(at, vars.size() - at));
+}
+
+BoolePolynomial PolynomialBuilder::build()
+{
+    // Lexicographic order puts monomials sharing a prefix next to each other,
+    // the prefix itself (if present) being first
+    std::sort(terms.begin(), terms.end(),
+              [&](const pair<size_t, size_t>& a, const pair<size_t, size_t>& b) {
+                  return std::lexicographical_compare(
+                      vars.begin() + a.first, vars.begin() + a.first + a.second,
+                      vars.begin() + b.first, vars.begin() + b.first + b.second);
+              });
+
+    // x + x = 0, so only monomials occurring an odd number of times remain
+    size_t kept = 0;
+    for (size_t i = 0; i < terms.size();) {
+        size_t j = i + 1;
+        while (j < terms.size() && lenAt(j) == lenAt(i) &&
+               std::equal(vars.begin() + terms[i].first,
+                          vars.begin() + terms[i].first + lenAt(i),
+                          vars.begin() + terms[j].first)) {
+            j++;
+        }
+        if ((j - i) % 2 == 1) {
+            terms[kept++] = terms[i];
+        }
+        i = j;
+    }
+    terms.resize(kept);
+
+    BoolePolynomial ret(buildSet(0, terms.size(), 0));
+    vars.clear();
+    terms.clear();
+    return ret;
+}
+
+// terms[lo, hi) all share their first 'depth' variables
+BooleSet PolynomialBuilder::buildSet(size_t lo, size_t hi, size_t depth) const
+{
+    bool hasOne = false;
+    if (lo < hi && lenAt(lo) == depth) {
+        hasOne = true;
+        lo++;
+    }
+
+    // Chain the blocks with the same next variable along the else-branches,
+    // starting from the one with the highest variable index
+    BooleSet ret = hasOne ? ring.one() : ring.zero();
+    size_t blockEnd = hi;
+    while (blockEnd > lo) {
+        const uint32_t v = varAt(blockEnd - 1, depth);
+        size_t blockBeg = blockEnd - 1;
+        while (blockBeg > lo && varAt(blockBeg - 1, depth) == v) {
+            blockBeg--;
+        }
+        BooleSet then = buildSet(blockBeg, blockEnd, depth + 1);
+        ret = BooleSet(v, then, ret);
+        blockEnd = blockBeg;
+    }
+    return ret;
+}
+
+bool BLib::normalize_clause(vector<Lit>& lits)
+{
+    std::sort(lits.begin(), lits.end());
+    lits.erase(std::unique(lits.begin(), lits.end()), lits.end());
+    for (size_t i = 1; i < lits.size(); i++) {
+        if (lits[i].var() == lits[i - 1].var()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool BLib::is_implication_pair(const BoolePolynomial& poly, uint32_t& x)
+{
+    if (!poly.isPair() || poly.hasConstantPart()) {
+        return false;
+    }
+    vector<BooleMonomial> terms;
+    for (const BooleMonomial& mono : poly) {
+        terms.push_back(mono);
+    }
+    if (terms[0].deg() < terms[1].deg()) {
+        std::swap(terms[0], terms[1]);
+    }
+    if (terms[1].deg() != 1 || !terms[0].reducibleBy(terms[1])) {
+        return false;
+    }
+    x = terms[1].firstIndex();
+    return true;
+}
+
+BoolePolynomial BLib::clause_to_poly(const Lit* beg, const Lit* end,
+                                     const BoolePolyRing& ring)
+{
+    // Bottom-up, so highest variable first
+    BooleSet ret = ring.one();
+    while (end != beg) {
+        --end;
+        if (end->sign()) {
+            ret = BooleSet(end->var(), ret, ring.zero());
+        } else {
+            ret = BooleSet(end->var(), ret, ret);
+        }
+    }
+    return BoolePolynomial(ret);
+}
+
+BoolePolynomial BLib::clause_to_poly(const vector<Lit>& lits,
+                                     const BoolePolyRing& ring)
+{
+    vector<Lit> sorted(lits);
+    // x*(x+1) = 0, the clause is a tautology
+    if (!normalize_clause(sorted)) {
+        return BoolePolynomial(ring);
+    }
+    return clause_to_poly(sorted.data(), sorted.data() + sorted.size(), ring);
+}
+
+BoolePolynomial BLib::xor_to_poly(const XClause& x, const BoolePolyRing& ring)
+{
+    PolynomialBuilder builder(ring);
+    for (const uint32_t v : x.getVars()) {
+        builder.addMonomial(&v, &v + 1);
+    }
+    builder.addConstant(x.getRHS());
+    return builder.build();
+}
+
+vector<BoolePolynomial> BLib::expand_factored(const FactoredPoly& fp,
+                                              const BoolePolyRing& ring)
+{
+    // Nodes only refer to nodes after them, so go backwards
+    vector<BoolePolynomial> ret(fp.nodes.size(), BoolePolynomial(ring));
+    PolynomialBuilder builder(ring);
+    for (size_t i = fp.nodes.size(); i-- > 0;) {
+        const FactoredPoly::Node& n = fp.nodes[i];
+        BoolePolynomial products(ring);
+        for (const FactoredPoly::Term& t : n.terms) {
+            if (t.subs.empty()) {
+                builder.addMonomial(t.vars.data(),
+                                    t.vars.data() + t.vars.size());
+                continue;
+            }
+            BooleMonomial m(ring);
+            for (const uint32_t v : t.vars) {
+                m *= BooleVariable(v, ring);
+            }
+            BoolePolynomial prod(m);
+            for (const size_t sub : t.subs) {
+                prod *= ret[sub];
+            }
+            products += prod;
+        }
+        builder.addConstant(n.constant);
+        ret[i] = builder.build() + products;
+    }
+    return ret;
+}
+
+void BLib::print_poly(std::ostream& os, const BoolePolynomial& poly,
+                      const vector<uint32_t>& origVars)
+{
+    if (origVars.empty()) {
+        os << poly;
+        return;
+    }
+    if (poly.isZero()) {
+        os << "0";
+        return;
+    }
+
+    bool first = true;
+    for (BoolePolynomial::const_iterator it = poly.begin(), end = poly.end();
+         it != end; it++) {
+        if (!first) {
+            os << " + ";
+        }
+        first = false;
+
+        if (it->isConstant()) {
+            os << "1";
+            continue;
+        }
+        bool firstVar = true;
+        for (BooleMonomial::const_iterator v = it->begin(), vend = it->end();
+             v != vend; v++) {
+            if (!firstVar) {
+                os << "*";
+            }
+            firstVar = false;
+            os << "x(" << origVars[*v] << ")";
+        }
+    }
+}
@@ -22,11 +22,85 @@ SOFTWARE.
 
 #pragma once
 
+#include <cstdint>
+#include <utility>
 #include <vector>
+#include "bosphincludes.hpp"
+#include "factoredpoly.hpp"
+#include "xclause.hpp"
 #include <polybori/polybori.h>
 
 namespace BLib {
 
+// Sums up monomials given as arrays of variable indices. Instead of one ZDD
+// addition per monomial, the monomials are collected, sorted, and the
+// polynomial is built in a single bottom-up pass over the ZDD.
+class PolynomialBuilder
+{
+   public:
+    explicit PolynomialBuilder(const polybori::BoolePolyRing& _ring)
+        : ring(_ring)
+    {
+    }
+
+    // Variables may be in any order and may repeat; x*x = x.
+    // The empty monomial is the constant 1.
+    void addMonomial(const uint32_t* beg, const uint32_t* end);
+    void addConstant(const bool one)
+    {
+        if (one)
+            addMonomial(NULL, NULL);
+    }
+
+    // Returns the sum of the monomials added so far, and starts over
+    polybori::BoolePolynomial build();
+
+   private:
+    polybori::BooleSet buildSet(size_t lo, size_t hi, size_t depth) const;
+    uint32_t varAt(size_t term, size_t depth) const
+    {
+        return vars[terms[term].first + depth];
+    }
+    size_t lenAt(size_t term) const
+    {
+        return terms[term].second;
+    }
+
+    const polybori::BoolePolyRing& ring;
+    std::vector<uint32_t> vars;
+    std::vector<std::pair<size_t, size_t> > terms; ///< (offset, length) in vars
+};
+
+// Sorts the literals and removes duplicates. Returns false if the clause
+// is a tautology, i.e. it has both a literal and its negation.
+bool normalize_clause(std::vector<Lit>& lits);
+
+// True if 'poly' is "x*m + x", i.e. x*(m + 1) = 0, in which case x implies
+// every variable of m. 'x' is set to x.
+bool is_implication_pair(const polybori::BoolePolynomial& poly, uint32_t& x);
+
+// The polynomial that is zero iff the clause is satisfied, i.e. the product
+// of (x+1) for positive and of x for negative literals. Built directly as a
+// ZDD, so it costs O(size) even though it has 2^(positive literals) terms.
+// This one takes a normalized, non-tautological clause.
+polybori::BoolePolynomial clause_to_poly(const Lit* beg, const Lit* end,
+                                         const polybori::BoolePolyRing& ring);
+polybori::BoolePolynomial clause_to_poly(const std::vector<Lit>& lits,
+                                         const polybori::BoolePolyRing& ring);
+
+// Expands every node of a factored polynomial; [0] is the whole polynomial
+std::vector<polybori::BoolePolynomial> expand_factored(
+    const FactoredPoly& fp, const polybori::BoolePolyRing& ring);
+
+// Prints the polynomial the way BRiAl does, but if origVars is not empty,
+// variable 'v' is printed as x(origVars[v])
+void print_poly(std::ostream& os, const polybori::BoolePolynomial& poly,
+                const std::vector<uint32_t>& origVars);
+
+// The linear polynomial that is zero iff the XOR constraint holds
+polybori::BoolePolynomial xor_to_poly(const XClause& x,
+                                      const polybori::BoolePolyRing& ring);
+
 std::pair<bool, double> if_sample_and_clone(
     const std::vector<polybori::BoolePolynomial>& eqs, double log2size);
 
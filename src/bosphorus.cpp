@@ -22,14 +22,23 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 ***********************************************/
 
+#include <algorithm>
+#include <memory>
+#include <thread>
+
 #include "bosphorus.hpp"
 
 #include "GitSHA1.hpp"
+#include "anfbinary.hpp"
+#include "anfparser.hpp"
+#include "anfutils.hpp"
 #include "elimlin.hpp"
 #include "extendedlinearization.hpp"
 #include "dimacscache.hpp"
+#include "gatefinder.hpp"
 #include "gaussjordan.hpp"
 #include "replacer.hpp"
+#include "xorfinder.hpp"
 #include "time_mem.h"
 #include "bosphincludes.hpp"
 #include "elimlin.hpp"
@@ -50,9 +59,27 @@ public:
     vector<Clause> clauses_needed_for_anf_import;
     vector<BoolePolynomial> learnt;
 
+    // Parsed CNF files, so that simplify() and write_cnf() don't re-parse
+    // the input CNF every time they need its clauses
+    map<string, std::unique_ptr<BLib::DIMACSCache> > dimacs;
+    const BLib::DIMACSCache* get_dimacs(const char* fname);
+
     bool read_in_data = false;
 };
 
+const BLib::DIMACSCache* PrivateData::get_dimacs(const char* fname)
+{
+    if (fname == NULL) {
+        return NULL;
+    }
+
+    std::unique_ptr<BLib::DIMACSCache>& d = dimacs[fname];
+    if (!d) {
+        d.reset(new BLib::DIMACSCache(fname));
+    }
+    return d.get();
+}
+
 void output_anf_to_cnf_map(const BLib::ANF* anf, const BLib::CNF* cnf,
                     std::ofstream& ofs)
 {
@@ -60,10 +87,10 @@ void output_anf_to_cnf_map(const BLib::ANF* anf, const BLib::CNF* cnf,
         Lit l = anf->getReplaced(i);
         BooleVariable v(l.var(), anf->getRing());
         if (l.sign()) {
-            ofs << "c Internal ANF map " << i + 1 << " = 1+x(" << cnf->getVarForMonom(v) << ")"
+            ofs << "c Internal ANF map " << anf->getOrigVar(i) + 1 << " = 1+x(" << cnf->getVarForMonom(v) << ")"
                 << endl;
         } else {
-            ofs << "c Internal ANF map " << i + 1 << " = x(" << cnf->getVarForMonom(v) << ")"
+            ofs << "c Internal ANF map " << anf->getOrigVar(i) + 1 << " = x(" << cnf->getVarForMonom(v) << ")"
                 << endl;
         }
     }
@@ -71,8 +98,11 @@ void output_anf_to_cnf_map(const BLib::ANF* anf, const BLib::CNF* cnf,
         const BooleMonomial mono = cnf->getMonomForVar(i);
         if (mono.deg() > 0)
             assert(i == cnf->getVarForMonom(mono));
-        if (mono.deg() > 1)
-            ofs << "c Internal ANF map " << i + 1 << " = " << mono << endl;
+        if (mono.deg() > 1) {
+            ofs << "c Internal ANF map " << i + 1 << " = ";
+            BLib::print_poly(ofs, mono, anf->getOrigVars());
+            ofs << endl;
+        }
     }
 }
 
@@ -100,7 +130,9 @@ void output_cnf(
     ofs << "c Learnt " << dat->learnt.size() << " fact(s), not all of which have been dumped\n";
     if (dat->config.writecomments) {
         for (const BoolePolynomial& poly : dat->learnt) {
-            ofs << "c " << poly << endl;
+            ofs << "c ";
+            BLib::print_poly(ofs, poly, anf->getOrigVars());
+            ofs << endl;
         }
         ofs << "c Given mapping below." << endl;
         output_anf_to_cnf_map(anf, cnf, ofs);
@@ -140,14 +172,47 @@ Bosph::ANF* Bosphorus::read_anf(const char* fname)
     assert(fname != NULL);
     check_library_in_use();
 
-    // Find out maxVar in input ANF file
-    size_t maxVar = BLib::ANF::readFileForMaxVar(fname);
+    // Tokenize the file once, this also finds out maxVar
+    BLib::ANFParser parser;
+    parser.parseFile(fname, dat->config.numThreads, dat->config.renumber);
 
     // Construct ANF
     // ring size = maxVar + 1, because ANF variables start from x0
-    dat->pring = new BoolePolyRing(maxVar + 1);
+    dat->pring = new BoolePolyRing(parser.getMaxVar() + 1);
     auto anf = new BLib::ANF(dat->pring, dat->config);
-    anf->readFile(fname);
+    anf->readFile(parser);
+    return (Bosph::ANF*)anf;
+}
+
+void Bosphorus::save_binary(const char* fname, const Bosph::ANF* a) const
+{
+    auto anf = (const BLib::ANF*)a;
+    BLib::BinaryWriter w;
+    w.writeHeader(anf->getRing().nVariables());
+    anf->saveBinary(w);
+
+    w.writeVarint(dat->learnt.size());
+    for (const BoolePolynomial& poly : dat->learnt) {
+        w.writePoly(poly);
+    }
+    w.saveToFile(fname);
+}
+
+Bosph::ANF* Bosphorus::load_binary(const char* fname)
+{
+    assert(fname != NULL);
+    check_library_in_use();
+
+    BLib::BinaryReader r(fname);
+    dat->pring = new BoolePolyRing(r.readHeader());
+    auto anf = new BLib::ANF(dat->pring, dat->config);
+    anf->loadBinary(r);
+
+    BLib::PolynomialBuilder builder(*dat->pring);
+    const uint64_t numLearnt = r.readVarint();
+    for (uint64_t i = 0; i < numLearnt; i++) {
+        dat->learnt.push_back(r.readPoly(builder));
+    }
     return (Bosph::ANF*)anf;
 }
 
@@ -160,24 +225,148 @@ Bosph::ANF* Bosphorus::start_cnf_input(uint32_t max_vars)
 
 void Bosphorus::add_clause(Bosph::ANF* anf, const std::vector<int>& clause)
 {
-    BoolePolynomial poly(1, *dat->pring);
+    vector<Lit> lits;
+    lits.reserve(clause.size());
     for (const int lit: clause) {
         assert(lit != 0);
-        BoolePolynomial alsoAdd(*dat->pring);
-        if (lit < 0)
-            alsoAdd = poly;
-        poly *= BooleVariable(std::abs(lit)-1, *dat->pring);
-        poly += alsoAdd;
+        lits.push_back(Lit(std::abs(lit)-1, lit < 0));
+    }
+    ((BLib::ANF*)anf)->addBoolePolynomial(BLib::clause_to_poly(lits, *dat->pring));
+}
+
+namespace {
+
+// Clauses normalized by one thread, tautologies dropped
+struct ClauseBuffer {
+    vector<Lit> lits;
+    vector<size_t> ends;     ///<ends[i]: end of clause 'i' in 'lits'
+    ///(var, number of clauses 'var' is in), sorted, touched vars only
+    vector<std::pair<uint32_t, size_t> > varCount;
+    int badLit = 0; ///<literal over a variable the ANF doesn't have, if any
+};
+
+// Sorts 'vars' and turns it into (var, occurrences) pairs in 'out'
+void count_vars(vector<uint32_t>& vars,
+                vector<std::pair<uint32_t, size_t> >& out)
+{
+    std::sort(vars.begin(), vars.end());
+    out.clear();
+    for (const uint32_t v : vars) {
+        if (out.empty() || out.back().first != v) {
+            out.push_back(std::make_pair(v, 0));
+        }
+        out.back().second++;
+    }
+}
+
+void normalize_clauses(const int* lits, const size_t* offsets,
+                       const size_t beg, const size_t end,
+                       const uint32_t numVars, ClauseBuffer& out)
+{
+    out.lits.reserve(offsets[end] - offsets[beg]);
+    out.ends.reserve(end - beg);
+
+    vector<Lit> clause;
+    for (size_t i = beg; i < end; i++) {
+        clause.clear();
+        for (size_t j = offsets[i]; j < offsets[i + 1]; j++) {
+            const int lit = lits[j];
+            assert(lit != 0);
+            const uint32_t var = std::abs(lit) - 1;
+            if (var >= numVars) {
+                // Reported by the calling thread, once all workers are done
+                out.badLit = lit;
+                return;
+            }
+            clause.push_back(Lit(var, lit < 0));
+        }
+        if (!BLib::normalize_clause(clause)) {
+            continue;
+        }
+        out.lits.insert(out.lits.end(), clause.begin(), clause.end());
+        out.ends.push_back(out.lits.size());
+    }
+
+    vector<uint32_t> vars;
+    vars.reserve(out.lits.size());
+    for (const Lit l : out.lits) {
+        vars.push_back(l.var());
+    }
+    count_vars(vars, out.varCount);
+}
+
+}
+
+void Bosphorus::add_clauses(Bosph::ANF* a, const int* lits,
+                            const size_t* offsets, const size_t num)
+{
+    auto anf = (BLib::ANF*)a;
+    const uint32_t numVars = dat->pring->nVariables();
+
+    // The ring is not thread-safe, so the threads only sort out the
+    // literals; the ZDDs are built afterwards, in clause order
+    static const size_t min_chunk_size = 100000;
+    const size_t numThreads = std::max<size_t>(
+        1, std::min<size_t>(dat->config.numThreads, num / min_chunk_size));
+    vector<ClauseBuffer> bufs(numThreads);
+    vector<std::thread> threads;
+    for (size_t i = 1; i < numThreads; i++) {
+        threads.push_back(std::thread(
+            normalize_clauses, lits, offsets, num * i / numThreads,
+            num * (i + 1) / numThreads, numVars, std::ref(bufs[i])));
+    }
+    normalize_clauses(lits, offsets, 0, num / numThreads, numVars, bufs[0]);
+    for (std::thread& t : threads) {
+        t.join();
+    }
+    for (const ClauseBuffer& buf : bufs) {
+        if (buf.badLit != 0) {
+            cout << "ERROR: clause has variable " << std::abs(buf.badLit)
+                 << " but the ANF only has " << numVars << " variables"
+                 << endl;
+            exit(-1);
+        }
+    }
+
+    size_t numClauses = 0;
+    vector<std::pair<uint32_t, size_t> > varCount;
+    for (const ClauseBuffer& buf : bufs) {
+        numClauses += buf.ends.size();
+        varCount.insert(varCount.end(), buf.varCount.begin(),
+                        buf.varCount.end());
+    }
+    if (bufs.size() > 1) {
+        std::sort(varCount.begin(), varCount.end());
+        size_t j = 0;
+        for (size_t i = 0; i < varCount.size(); i++) {
+            if (j > 0 && varCount[j - 1].first == varCount[i].first) {
+                varCount[j - 1].second += varCount[i].second;
+            } else {
+                varCount[j++] = varCount[i];
+            }
+        }
+        varCount.resize(j);
+    }
+    anf->reserve(numClauses, varCount);
+
+    for (const ClauseBuffer& buf : bufs) {
+        size_t start = 0;
+        for (const size_t end : buf.ends) {
+            anf->addBoolePolynomial(BLib::clause_to_poly(
+                buf.lits.data() + start, buf.lits.data() + end, *dat->pring));
+            start = end;
+        }
     }
-    ((BLib::ANF*)anf)->addBoolePolynomial(poly);
 }
 
 Bosph::ANF* Bosphorus::read_cnf(const char* fname)
 {
     check_library_in_use();
 
-    Bosph::DIMACS* dimacs = parse_cnf(fname);
-    return chunk_dimacs(dimacs);
+    // The parsed file is kept, simplify() and write_cnf() use it again
+    assert(fname != NULL);
+    auto dimacs = (BLib::DIMACSCache*)dat->get_dimacs(fname);
+    return chunk_dimacs((Bosph::DIMACS*)dimacs);
 }
 
 Bosph::DIMACS* Bosphorus::parse_cnf(const char* fname)
@@ -211,9 +400,44 @@ Bosph::ANF* Bosphorus::chunk_dimacs(Bosph::DIMACS* dim)
         cout << "c [cnf-to-anf] Chopping up CNF with " << orig_var << " variables." << endl;
     }
 
+    // XORs encoded as clauses become linear equations
+    std::unique_ptr<BLib::XorFinder> xorFinder;
+    if (dat->config.xorFindMax >= 2) {
+        double myTime = cpuTime();
+        xorFinder.reset(new BLib::XorFinder(orig_clauses,
+                                            dat->config.xorFindMax));
+        if (dat->config.verbosity >= 1) {
+            cout << "c [cnf-to-anf] XORs recovered: "
+                 << xorFinder->getXors().size()
+                 << " Clauses covered: " << xorFinder->getNumCovered()
+                 << " T: " << (cpuTime() - myTime) << endl;
+        }
+    }
+
+    // Gates become one equation each, their clauses are not needed
+    std::unique_ptr<BLib::GateFinder> gateFinder;
+    if (dat->config.findGates) {
+        double myTime = cpuTime();
+        gateFinder.reset(new BLib::GateFinder(orig_clauses, orig_var,
+                                              dat->config.cutNum));
+        if (dat->config.verbosity >= 1) {
+            cout << "c [cnf-to-anf] Gates found. AND: "
+                 << gateFinder->getNumAnd()
+                 << " ITE: " << gateFinder->getNumIte()
+                 << " Clauses covered: " << gateFinder->getNumCovered()
+                 << " T: " << (cpuTime() - myTime) << endl;
+        }
+    }
+
     // Chunk up by L positive literals. L = config.cutNum
     vector<Clause> chunked_clauses;
-    for (auto clause : orig_clauses) {
+    for (size_t i = 0; i < orig_clauses.size(); i++) {
+        if ((gateFinder && gateFinder->isCovered(i))
+            || (xorFinder && xorFinder->isCovered(i))
+        ) {
+            continue;
+        }
+        const Clause& clause = orig_clauses[i];
         // small already
         if (clause.size() <= dat->config.cutNum) {
             chunked_clauses.push_back(clause);
@@ -277,6 +501,7 @@ Bosph::ANF* Bosphorus::chunk_dimacs(Bosph::DIMACS* dim)
         << (maxVar-orig_var)
         << " Extra cls needed : " << dat->clauses_needed_for_anf_import.size()
         << " Chunked cls: " << chunked_clauses.size()
+        << " XORs: " << dimacs->getXors().size()
         << " Vars: " << maxVar
         << endl;
     }
@@ -285,22 +510,40 @@ Bosph::ANF* Bosphorus::chunk_dimacs(Bosph::DIMACS* dim)
     dat->pring = new BoolePolyRing(maxVar);
     auto anf = new BLib::ANF(dat->pring, dat->config);
     for (auto clause : chunked_clauses) {
-        BoolePolynomial poly(1, *dat->pring);
         for (const Lit& l : clause.getLits()) {
-            BoolePolynomial alsoAdd(*dat->pring);
-            if (!l.sign()) {
-                alsoAdd = poly;
-            }
             assert(l.var() < maxVar);
-            poly *= BooleVariable(l.var(), *dat->pring);
-            poly += alsoAdd;
         }
+        BoolePolynomial poly = BLib::clause_to_poly(clause.getLits(), *dat->pring);
         anf->addBoolePolynomial(poly);
         if (dat->config.verbosity >= 5) {
             cout << clause << " -> " << poly << endl;
         }
     }
 
+    if (gateFinder) {
+        for (const BLib::Gate& gate : gateFinder->getGates()) {
+            BoolePolynomial poly = BLib::gate_to_poly(gate, *dat->pring);
+            anf->addBoolePolynomial(poly);
+            if (dat->config.verbosity >= 5) {
+                cout << "gate -> " << poly << endl;
+            }
+        }
+    }
+
+    // XORs are linear already, no need to go through clauses
+    vector<BLib::XClause> xors = dimacs->getXors();
+    if (xorFinder) {
+        xors.insert(xors.end(), xorFinder->getXors().begin(),
+                    xorFinder->getXors().end());
+    }
+    for (const BLib::XClause& x : xors) {
+        BoolePolynomial poly = BLib::xor_to_poly(x, *dat->pring);
+        anf->addBoolePolynomial(poly);
+        if (dat->config.verbosity >= 5) {
+            cout << x << " -> " << poly << endl;
+        }
+    }
+
     return (Bosph::ANF*)anf;
 }
 
@@ -365,6 +608,12 @@ void Bosphorus::get_solution_map(const Bosph::ANF* a, map<uint32_t, VarMap>& ret
 }
 
 
+uint32_t Bosphorus::get_orig_var(const Bosph::ANF* a, uint32_t var) const
+{
+    auto anf = (const BLib::ANF*)a;
+    return anf->getOrigVar(var);
+}
+
 std::set<size_t> Bosphorus::get_proj_set(const Bosph::ANF* a) const
 {
     auto anf = (const BLib::ANF*)a;
@@ -399,7 +648,8 @@ Bosph::CNF* Bosphorus::cnf_from_anf_and_cnf(const char* cnf_fname, const ANF* a)
     double convStartTime = cpuTime();
 
     //Add init, trivial, and clauses_needed_for_anf_import to CNF + original CNF
-    auto cnf = new BLib::CNF(cnf_fname, *anf, dat->clauses_needed_for_anf_import, dat->config);
+    auto cnf = new BLib::CNF(dat->get_dimacs(cnf_fname), *anf,
+                             dat->clauses_needed_for_anf_import, dat->config);
 
     if (dat->config.verbosity >= 2) {
         cout << "c [CNF enhancing] in " << (cpuTime() - convStartTime)
@@ -473,6 +723,7 @@ bool Bosphorus::simplify(ANF* a, const char* orig_cnf_file, uint32_t max_iters)
                 case 0:
                     if (dat->config.doXL) {
                         sub_iter_performed = true;
+                        anf->compact();
                         if (!extendedLinearization(dat->config, anf->getEqs(),
                                                    dat->learnt)) {
                             anf->setNOTOK();
@@ -491,6 +742,7 @@ bool Bosphorus::simplify(ANF* a, const char* orig_cnf_file, uint32_t max_iters)
                 case 1:
                     if (dat->config.doEL) {
                         sub_iter_performed = true;
+                        anf->compact();
                         if (!elimLin(dat->config, anf->getEqs(), dat->learnt)) {
                             anf->setNOTOK();
                         } else {
@@ -512,7 +764,7 @@ bool Bosphorus::simplify(ANF* a, const char* orig_cnf_file, uint32_t max_iters)
                         if (orig_cnf_file) {
                             if (cnf == NULL) {
                                 assert(sbs == NULL);
-                                cnf = new BLib::CNF(orig_cnf_file, *anf,
+                                cnf = new BLib::CNF(dat->get_dimacs(orig_cnf_file), *anf,
                                               dat->clauses_needed_for_anf_import, dat->config);
                                 sbs = new BLib::SimplifyBySat(*cnf, dat->config);
                             } else {
@@ -609,9 +861,10 @@ bool Bosphorus::simplify(ANF* a, const char* orig_cnf_file, uint32_t max_iters)
 void Bosphorus::deduplicate()
 {
     vector<BoolePolynomial> dedup;
-    BLib::ANF::eqs_hash_t hash;
+    BLib::PolySet seen;
+    seen.reserve(dat->learnt.size());
     for (const BoolePolynomial& p : dat->learnt) {
-        if (hash.insert(p.hash()).second)
+        if (seen.insert(p))
             dedup.push_back(p);
     }
     if (dat->config.verbosity >= 3) {
@@ -620,31 +873,53 @@ void Bosphorus::deduplicate()
     dat->learnt.swap(dedup);
 }
 
-void Bosphorus::add_trivial_learnt_from_anf_to_learnt(ANF* a, ANF* o)
+// Adds the values and (anti)equivalences of 'anf' for which
+// wasThere(poly) is false
+template <class F>
+static void add_new_trivial_learnt(const BLib::ANF* anf,
+                                   vector<BoolePolynomial>& learnt,
+                                   F wasThere)
 {
-    auto anf = (BLib::ANF*)a;
-    auto other = (BLib::ANF*)o;
-
-    const BLib::ANF::eqs_hash_t& orig_eqs_hash = other->getEqsHash();
-
-    // Add *NEW* assignments and equivalences
     for (uint32_t v = 0; v < anf->getRing().nVariables(); v++) {
         const lbool val = anf->value(v);
         const Lit lit = anf->getReplaced(v);
         BooleVariable bv = anf->getRing().variable(v);
         if (val != l_Undef) {
             BoolePolynomial assignment(bv + BooleConstant(val == l_True));
-            if (orig_eqs_hash.find(assignment.hash()) == orig_eqs_hash.end())
-                dat->learnt.push_back(assignment);
+            if (!wasThere(assignment))
+                learnt.push_back(assignment);
         } else if (lit != Lit(v, false)) {
             BooleVariable bv2 = anf->getRing().variable(lit.var());
             BoolePolynomial equivalence(bv + bv2 + BooleConstant(lit.sign()));
-            if (orig_eqs_hash.find(equivalence.hash()) == orig_eqs_hash.end())
-                dat->learnt.push_back(equivalence);
+            if (!wasThere(equivalence))
+                learnt.push_back(equivalence);
         }
     }
 }
 
+void Bosphorus::add_trivial_learnt_from_anf_to_learnt(ANF* a, ANF* o)
+{
+    auto anf = (BLib::ANF*)a;
+    auto other = (BLib::ANF*)o;
+
+    const BLib::ANF::eqs_hash_t& orig_eqs_hash = other->getEqsHash();
+
+    // Add *NEW* assignments and equivalences
+    add_new_trivial_learnt(anf, dat->learnt, [&](const BoolePolynomial& p) {
+        return orig_eqs_hash.contains(p);
+    });
+}
+
+void Bosphorus::add_trivial_learnt_from_anf_to_learnt(ANF* a)
+{
+    auto anf = (BLib::ANF*)a;
+
+    // Add *NEW* assignments and equivalences
+    add_new_trivial_learnt(anf, dat->learnt, [&](const BoolePolynomial& p) {
+        return anf->inSnapshot(p);
+    });
+}
+
 vector<Clause> Bosphorus::get_learnt(ANF* a)
 {
     auto anf = (BLib::ANF*)a;
@@ -711,6 +986,18 @@ Bosph::ANF* Bosphorus::copy_anf_no_replacer(Bosph::ANF* a)
     return (Bosph::ANF*)orig_anf;
 }
 
+void Bosphorus::snapshot_anf(Bosph::ANF* a)
+{
+    auto anf = (BLib::ANF*)a;
+    anf->takeSnapshot();
+}
+
+void Bosphorus::drop_snapshot(Bosph::ANF* a)
+{
+    auto anf = (BLib::ANF*)a;
+    anf->dropSnapshot();
+}
+
 void Bosphorus::print_anf(Bosph::ANF* a)
 {
     auto anf = (BLib::ANF*)a;
@@ -51,6 +51,8 @@ public:
 
     // To read CNF or ANF
     ANF* read_anf(const char* fname);
+    // The file is parsed once, and reused when it is given to simplify()
+    // or write_cnf()
     ANF* read_cnf(const char* fname);
     DIMACS* parse_cnf(const char* fname);
     ANF* chunk_dimacs(DIMACS* dimacs);
@@ -61,6 +63,15 @@ public:
     // To insert dynamically generated CNF
     ANF* start_cnf_input(uint32_t max_vars);
     void add_clause(ANF* anf, const std::vector<int>& clause);
+    // Adds many DIMACS-style clauses at once, clause 'i' being
+    // lits[offsets[i]] .. lits[offsets[i+1]-1]. 'offsets' has num+1 entries.
+    void add_clauses(ANF* anf, const int* lits, const size_t* offsets,
+                     size_t num);
+
+    // Binary checkpoints: the ANF with its fixed and replaced variables,
+    // plus the facts learnt so far
+    void save_binary(const char* fname, const ANF* anf) const;
+    ANF* load_binary(const char* fname);
 
     // Output functions
     void write_anf(const char* fname, const ANF* anf);
@@ -75,6 +86,9 @@ public:
     void get_solution_map(const ANF* a, std::map<uint32_t, VarMap>& ret) const;
     void get_solution_map(const CNF* c, std::map<uint32_t, VarMap>& ret) const;
     std::set<size_t> get_proj_set(const Bosph::ANF* a) const;
+    // All of the above use internal variable numbers. With renumbering,
+    // this gives the index a variable has in the input file.
+    uint32_t get_orig_var(const ANF* a, uint32_t var) const;
 
 
     CNF* anf_to_cnf(const ANF* anf);
@@ -88,6 +102,8 @@ public:
     void add_trivial_learnt_from_anf_to_learnt(
         ANF* anf,
         ANF* other);
+    // Same, against the equations of 'anf' when snapshot_anf() was called
+    void add_trivial_learnt_from_anf_to_learnt(ANF* anf);
 
     size_t get_learnt_size() const;
     static void delete_anf(ANF* anf);
@@ -95,6 +111,10 @@ public:
     static bool evaluate(const ANF* anf, const vector<lbool>& sol);
     static void print_stats(ANF* anf);
     static ANF* copy_anf_no_replacer(ANF* anf);
+    // Remembers the current equations of the ANF, without copying them:
+    // only what is added and removed afterwards is recorded
+    static void snapshot_anf(ANF* anf);
+    static void drop_snapshot(ANF* anf);
     static void print_anf(ANF* a);
 
     vector<Clause> get_clauses(CNF* cnf);
@@ -26,6 +26,7 @@ SOFTWARE.
 #include <iterator>
 #include <ostream>
 
+#include "anfutils.hpp"
 #include "dimacscache.hpp"
 #include "anfcnfutils.hpp"
 
@@ -40,11 +41,14 @@ CNF::CNF(const ANF& _anf, const ConfigData& _config)
     // Add regular equations
     const vector<BoolePolynomial>& eqs = anf.getEqs();
     for (const BoolePolynomial& poly : eqs) {
-        addBoolePolynomial(poly);
+        if (poly.isZero()) {
+            continue;
+        }
+        addBoolePolynomial(poly, anf.getFactored(poly));
     }
 }
 
-CNF::CNF(const char* fname,
+CNF::CNF(const DIMACSCache* dimacs,
          const ANF& _anf,
          const vector<Clause>& clauses_needed_for_anf_import,
          const ConfigData& _config)
@@ -54,11 +58,15 @@ CNF::CNF(const char* fname,
     addTrivialEquations();
 
     vector<Clause> setOfClauses;
-    if (fname) {
+    if (dimacs) {
         // add original CNF clauses
-        DIMACSCache dimacs_cache(fname);
         BoolePolynomial eq(0, anf.getRing());
-        clauses.push_back(std::make_pair(dimacs_cache.getClauses(), eq));
+        clauses.push_back(std::make_pair(dimacs->getClauses(), eq));
+
+        // XORs of the original CNF are cut up the same way as linear equations
+        for (const XClause& x : dimacs->getXors()) {
+            addBoolePolynomial(xor_to_poly(x, anf.getRing()));
+        }
     }
 
     //Add clauses needed to cut the large clauses into smaller ones
@@ -145,9 +153,10 @@ void CNF::addMonomialsFromPoly(const BoolePolynomial& eq)
     }
 }
 
-void CNF::addBoolePolynomial(const BoolePolynomial& poly)
+void CNF::addBoolePolynomial(const BoolePolynomial& poly,
+                             const FactoredPoly* factored)
 {
-    if (!in_clauses.insert(poly.hash()).second)
+    if (!in_clauses.insert(poly))
         return; // is already added
 
     // If UNSAT, make it UNSAT
@@ -167,6 +176,11 @@ void CNF::addBoolePolynomial(const BoolePolynomial& poly)
     if (poly.deg() > 1 && poly.nUsedVariables() <= config.brickestein_algo_cutoff &&
         BrickesteinAlgo32(poly, setOfClauses)) {
         addedAsCNF++;
+    } else if (factored != NULL && factored->size() < poly.length()) {
+        // Expanding would give more monomials than the factored form has
+        // variables, so stay factored
+        addedAsFactored++;
+        addFactored(*factored, setOfClauses);
     } else {
         // Represent using XOR & monomial combination
         // 1) add monmials
@@ -264,6 +278,150 @@ void CNF::addPolyWithCuts(BoolePolynomial poly, vector<Clause>& setOfClauses)
     }
 }
 
+uint32_t CNF::addAuxVar(const BoolePolynomial& meaning)
+{
+    const uint32_t v = next_cnf_var;
+    next_cnf_var++;
+    assert(revCombinedMap.size() == v);
+    revCombinedMap.push_back(meaning);
+    return v;
+}
+
+// Same as addPolyWithCuts(), but over CNF variables
+void CNF::addXorWithCuts(const vector<uint32_t>& vars, const bool rhs,
+                         vector<Clause>& setOfClauses)
+{
+    assert(config.cutNum > 1);
+
+    vector<uint32_t> vars_in_xor;
+    BoolePolynomial uptoPoly(getANFRing());
+    size_t i = 0;
+    while (true) {
+        //If only one would be left over, take it too instead of cutting
+        while (i < vars.size() &&
+               (vars_in_xor.size() < config.cutNum || i + 1 == vars.size())) {
+            vars_in_xor.push_back(vars[i]);
+            uptoPoly += revCombinedMap[vars[i]];
+            i++;
+        }
+        if (i == vars.size()) {
+            addEveryCombination(vars_in_xor, rhs, setOfClauses);
+            return;
+        }
+
+        //new cnf variable represents uptoPoly
+        const uint32_t varAdded = addAuxVar(uptoPoly);
+        vars_in_xor.push_back(varAdded);
+        addEveryCombination(vars_in_xor, false, setOfClauses);
+        vars_in_xor.clear();
+        vars_in_xor.push_back(varAdded);
+    }
+}
+
+void CNF::addFactored(const FactoredPoly& fp, vector<Clause>& setOfClauses)
+{
+    const vector<BoolePolynomial> expanded = expand_factored(fp, getANFRing());
+
+    //Sum of terms + constant = 0
+    vector<uint32_t> xorVars;
+    bool rhs = fp.nodes[0].constant;
+    for (const FactoredPoly::Term& t : fp.nodes[0].terms) {
+        rhs ^= addFactoredTerm(fp, t, expanded, xorVars, setOfClauses);
+    }
+    if (xorVars.empty()) {
+        if (rhs) {
+            setOfClauses.push_back(Clause(vector<Lit>()));
+        }
+        return;
+    }
+    addXorWithCuts(xorVars, rhs, setOfClauses);
+}
+
+// Adds the variable representing the term to xorVars. Returns true if the
+// term turns out to be constant 1 instead.
+bool CNF::addFactoredTerm(const FactoredPoly& fp, const FactoredPoly::Term& t,
+                          const vector<BoolePolynomial>& expanded,
+                          vector<uint32_t>& xorVars,
+                          vector<Clause>& setOfClauses)
+{
+    BooleMonomial m(getANFRing());
+    for (const uint32_t v : t.vars) {
+        m *= BooleVariable(v, getANFRing());
+    }
+    BoolePolynomial meaning(m);
+    for (const size_t sub : t.subs) {
+        meaning *= expanded[sub];
+    }
+
+    //Cancelled out, or just a monomial after all
+    if (meaning.isConstant()) {
+        return meaning.isOne();
+    }
+    if (meaning.isSingleton()) {
+        xorVars.push_back(addBooleMonomial(meaning.lead()));
+        return false;
+    }
+
+    //Inputs of the AND: the monomial part, and one variable per bracket
+    vector<uint32_t> ins;
+    if (!m.isConstant()) {
+        ins.push_back(addBooleMonomial(m));
+    }
+    for (const size_t sub : t.subs) {
+        const BoolePolynomial& s = expanded[sub];
+        if (s.isOne()) {
+            continue;
+        }
+        if (s.isSingleton()) {
+            ins.push_back(addBooleMonomial(s.lead()));
+        } else {
+            ins.push_back(addFactoredNode(fp, sub, expanded, setOfClauses));
+        }
+    }
+    if (ins.size() == 1) {
+        xorVars.push_back(ins[0]);
+        return false;
+    }
+
+    //create clauses e.g. '-a b', '-a c', and 'a -b -c'
+    const uint32_t a = addAuxVar(meaning);
+    vector<Lit> lits;
+    for (const uint32_t v : ins) {
+        lits.clear();
+        lits.push_back(Lit(a, true));
+        lits.push_back(Lit(v, false));
+        setOfClauses.push_back(Clause(lits));
+    }
+    lits.clear();
+    lits.push_back(Lit(a, false));
+    for (const uint32_t v : ins) {
+        lits.push_back(Lit(v, true));
+    }
+    setOfClauses.push_back(Clause(lits));
+
+    xorVars.push_back(a);
+    return false;
+}
+
+// Returns the variable equal to the bracket, which must not be constant or
+// a single monomial
+uint32_t CNF::addFactoredNode(const FactoredPoly& fp, const size_t node,
+                              const vector<BoolePolynomial>& expanded,
+                              vector<Clause>& setOfClauses)
+{
+    assert(!expanded[node].isConstant() && !expanded[node].isSingleton());
+
+    //n + sum of terms + constant = 0
+    const uint32_t n = addAuxVar(expanded[node]);
+    vector<uint32_t> xorVars(1, n);
+    bool rhs = fp.nodes[node].constant;
+    for (const FactoredPoly::Term& t : fp.nodes[node].terms) {
+        rhs ^= addFactoredTerm(fp, t, expanded, xorVars, setOfClauses);
+    }
+    addXorWithCuts(xorVars, rhs, setOfClauses);
+    return n;
+}
+
 uint32_t CNF::hammingWeight(uint64_t num) const
 {
     uint32_t ret = 0;
@@ -404,7 +562,8 @@ void CNF::print_solution_map(std::ofstream* ofs)
             //Only single-vars
             if (m.deg() == 1) {
                 const uint32_t var = m.firstVariable().index();
-                *ofs << "Internal-ANF-var " << var << " = solution-var " << i << endl;
+                *ofs << "Internal-ANF-var " << anf.getOrigVar(var)
+                     << " = solution-var " << i << endl;
             }
         }
     }
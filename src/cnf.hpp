@@ -35,11 +35,14 @@ using std::pair;
 
 namespace BLib {
 
+class DIMACSCache;
+
 class CNF
 {
    public:
     CNF(const ANF& _anf, const ConfigData& _config);
-    CNF(const char* fname, const ANF& _anf,
+    // 'dimacs' is the original CNF, its clauses are copied in; may be NULL
+    CNF(const DIMACSCache* dimacs, const ANF& _anf,
         const vector<Clause>& clauses_needed_for_anf_import,
         const ConfigData& _config);
 
@@ -68,6 +71,7 @@ class CNF
     size_t getAddedAsANF() const;
     size_t getAddedAsSimpleANF() const;
     size_t getAddedAsComplexANF() const;
+    size_t getAddedAsFactored() const;
     const vector<pair<vector<Clause>, BoolePolynomial> >& getClauses() const;
     vector<Clause> get_clauses_simple() const;
     uint32_t getNumVars() const;
@@ -79,7 +83,8 @@ class CNF
 
    private:
     void init();
-    void addBoolePolynomial(const BoolePolynomial& eq);
+    void addBoolePolynomial(const BoolePolynomial& eq,
+                            const FactoredPoly* factored = NULL);
     void addTrivialEquations();
     bool tryAddingPolyWithKarn(const BoolePolynomial& eq,
                                vector<Clause>& setOfClauses) const;
@@ -90,6 +95,19 @@ class CNF
     //Main adders
     uint32_t addBooleMonomial(const BooleMonomial& m);
 
+    //Adding in factored form, with a variable per bracket and per product
+    void addFactored(const FactoredPoly& fp, vector<Clause>& setOfClauses);
+    bool addFactoredTerm(const FactoredPoly& fp, const FactoredPoly::Term& t,
+                         const vector<BoolePolynomial>& expanded,
+                         vector<uint32_t>& xorVars,
+                         vector<Clause>& setOfClauses);
+    uint32_t addFactoredNode(const FactoredPoly& fp, size_t node,
+                             const vector<BoolePolynomial>& expanded,
+                             vector<Clause>& setOfClauses);
+    void addXorWithCuts(const vector<uint32_t>& vars, bool rhs,
+                        vector<Clause>& setOfClauses);
+    uint32_t addAuxVar(const BoolePolynomial& meaning);
+
     //Adding by enumeration (with cuts)
     void addPolyWithCuts(BoolePolynomial poly, vector<Clause>& setOfClauses);
     uint32_t hammingWeight(uint64_t num) const;
@@ -108,13 +126,14 @@ class CNF
     std::unordered_map<BooleMonomial::hash_type, uint32_t>
         monomMap; // map: outside monom -> inside var
     vector<BoolePolynomial>
-        revCombinedMap; // combines monomial map and xor maps; // map: inside var -> outside monom; // When cutting XORs, which var represents which XOR cut. Poly is of degree 1 here of course
+        revCombinedMap; // map: inside var -> what it stands for over the ANF variables. A monomial for monomial vars, the sum of the cut-off part for XOR cut vars, and any polynomial for the product and bracket aux vars of factored equations
     uint32_t next_cnf_var = 0; ///<CNF variable counter
 
     //stats
     size_t addedAsANF = 0;
     size_t addedAsSimpleANF = 0;
     size_t addedAsComplexANF = 0;
+    size_t addedAsFactored = 0;
     size_t addedAsCNF = 0;
 };
 
@@ -167,6 +186,11 @@ inline size_t CNF::getAddedAsComplexANF() const
     return addedAsComplexANF;
 }
 
+inline size_t CNF::getAddedAsFactored() const
+{
+    return addedAsFactored;
+}
+
 inline const vector<pair<vector<Clause>, BoolePolynomial> >& CNF::getClauses()
     const
 {
@@ -187,6 +211,7 @@ inline void CNF::printStats() const
          << "c Added as CNF         : " << getAddedAsCNF() << endl
          << "c Added as simple ANF  : " << getAddedAsSimpleANF() << endl
          << "c Added as complex  ANF: " << getAddedAsComplexANF() << endl
+         << "c Added as factored ANF: " << getAddedAsFactored() << endl
          << "c --------------------" << endl;
 }
 
@@ -39,9 +39,12 @@ struct ConfigData {
     bool printProcessedANF = false;
     uint32_t verbosity = 2;
     int simplify = 1;
+    bool renumber = false;
 
     // CNF conversion
     uint32_t cutNum = 5;
+    int findGates = true;
+    uint32_t xorFindMax = 6;
     uint32_t brickestein_algo_cutoff = 10;
 
     // Processes
@@ -20,16 +20,18 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 ***********************************************/
 
-#include <fstream>
 #include <iostream>
-#include <sstream>
 #include <algorithm>
-#include <complex>
+#include <cstring>
+#include <limits>
+#include <string>
 
 #include "dimacscache.hpp"
+#include "filereader.hpp"
 
 using std::cout;
 using std::endl;
+using std::string;
 
 using namespace BLib;
 
@@ -45,6 +47,18 @@ void DIMACSCache::addClause(const Lit* lits, const uint32_t size)
     }
 }
 
+void DIMACSCache::addXor(const Lit* lits, const uint32_t size)
+{
+    vector<uint32_t> vars(size);
+    bool rhs = true;
+    for(uint32_t i = 0; i < size; i ++) {
+        vars[i] = lits[i].var();
+        rhs ^= lits[i].sign();
+        maxVar = std::max<uint32_t>(maxVar, lits[i].var()+1);
+    }
+    xors.push_back(XClause(vars, rhs));
+}
+
 DIMACSCache::DIMACSCache(const char* _fname)
 {
     if (_fname == fname)
@@ -54,37 +68,98 @@ DIMACSCache::DIMACSCache(const char* _fname)
     maxVar = 0;
     clauses.clear();
 
-    std::ifstream ifs;
-    std::string temp;
-    std::string x;
-    ifs.open(fname);
-    if (!ifs) {
-        cout << "ERROR: Problem opening file '" << fname << "' for reading\n";
-        exit(-1);
+    ParseState st;
+    read_lines(fname, [&](const char* beg, const char* end) {
+        parse(beg, end, st);
+    });
+
+    clauses.reserve(st.ends.size());
+    size_t clStart = 0;
+    for (const size_t clEnd : st.ends) {
+        clauses.push_back(Clause(
+            vector<Lit>(st.lits.begin() + clStart, st.lits.begin() + clEnd)));
+        clStart = clEnd;
     }
+}
+
+static inline bool is_space(const char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// Clauses are terminated by '0' and may span several lines, or several
+// calls. Comment and header lines are skipped as a whole, with a
+// (vectorized) memchr.
+void DIMACSCache::parse(const char* at, const char* const end,
+                        ParseState& st)
+{
+    vector<Lit>& lits = st.lits;
+    vector<size_t>& ends = st.ends;
+    while (at < end) {
+        const char c = *at;
+        if (is_space(c)) {
+            at++;
+            continue;
+        }
 
-    vector<Lit> lits;
-    while (std::getline(ifs, temp)) {
-        if (temp.length() == 0 || temp[0] == 'p' || temp[0] == 'c') {
+        if (c == 'c' || c == 'p') {
+            const char* eol = (const char*)memchr(at, '\n', end - at);
+            at = (eol == NULL) ? end : eol + 1;
             continue;
-        } else if (temp[0] == 'x') {
-            cout << "ERROR: xor clause found in CNF, we cannot deal with that"
-                 << endl;
+        }
+
+        // XOR literals are collected after the clause literals, and moved
+        // out once the terminating '0' is seen
+        if (c == 'x') {
+            const size_t clStart = ends.empty() ? 0 : ends.back();
+            if (st.inXor || lits.size() != clStart) {
+                cout << "ERROR: 'x' in the middle of a clause in CNF" << endl;
+                exit(-1);
+            }
+            st.inXor = true;
+            at++;
+            continue;
+        }
+
+        const char* tokStart = at;
+        bool neg = false;
+        if (c == '-') {
+            neg = true;
+            at++;
+        }
+        uint64_t v = 0;
+        const char* digits = at;
+        while (at < end && *at >= '0' && *at <= '9') {
+            v = v * 10 + (*at - '0');
+            if (v > std::numeric_limits<int32_t>::max()) {
+                cout << "ERROR: variable too large in CNF: '"
+                     << string(tokStart, at + 1) << "'" << endl;
+                exit(-1);
+            }
+            at++;
+        }
+        if (at == digits || (at < end && !is_space(*at))) {
+            const char* tokEnd = at;
+            while (tokEnd < end && !is_space(*tokEnd)) {
+                tokEnd++;
+            }
+            cout << "ERROR: cannot parse literal '" << string(tokStart, tokEnd)
+                 << "' in CNF" << endl;
             exit(-1);
-        } else {
-            std::istringstream iss(temp);
-            lits.clear();
-            while (iss.good() && !iss.eof()) {
-                iss >> x;
-                int v = stoi(x);
-                if (v == 0) {
-                    clauses.push_back(Clause(lits));
-                    break;
-                } else {
-                    lits.push_back(Lit(std::abs(v) - 1, v < 0));
-                }
-                maxVar = std::max<uint32_t>(maxVar, std::abs(stoi(x)));
+        }
+
+        if (v == 0) {
+            if (st.inXor) {
+                const size_t clStart = ends.empty() ? 0 : ends.back();
+                addXor(lits.data() + clStart, lits.size() - clStart);
+                lits.resize(clStart);
+                st.inXor = false;
+            } else {
+                ends.push_back(lits.size());
             }
+        } else {
+            lits.push_back(Lit(v - 1, neg));
+            maxVar = std::max<uint32_t>(maxVar, v);
         }
     }
 }
@@ -24,6 +24,7 @@ SOFTWARE.
 
 #include <vector>
 #include "bosphincludes.hpp"
+#include "xclause.hpp"
 using namespace Bosph;
 
 namespace BLib {
@@ -34,8 +35,11 @@ class DIMACSCache
     DIMACSCache()
     {}
 
+    // The file may be gzip, xz or zstd compressed. XOR constraints are
+    // given as 'x' lines, e.g. "x1 -2 3 0" means x1 ^ !x2 ^ x3 = true.
     DIMACSCache(const char* _fname);
     void addClause(const Lit* lits, const uint32_t size);
+    void addXor(const Lit* lits, const uint32_t size);
 
     uint32_t getMaxVar(void) const
     {
@@ -47,8 +51,21 @@ class DIMACSCache
         return clauses;
     }
 
+    const std::vector<XClause>& getXors(void) const
+    {
+        return xors;
+    }
+
    private:
+    struct ParseState {
+        std::vector<Lit> lits;   ///<all clause literals, contiguously
+        std::vector<size_t> ends; ///<ends[i]: end of clause 'i' in 'lits'
+        bool inXor = false;      ///<literals being read are of an XOR
+    };
+    void parse(const char* at, const char* const end, ParseState& st);
+
     std::vector<Clause> clauses;
+    std::vector<XClause> xors;
     uint32_t maxVar = 0;
     const char* fname = nullptr;
 };
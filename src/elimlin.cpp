@@ -163,9 +163,13 @@ bool BLib::elimLin(const ConfigData& config, const vector<BoolePolynomial>& eqs,
     // Add possible useful knowledge back to actual ANF system
     for (BoolePolynomial& poly : all_equations) {
         // 1) Linear equations (includes assignments and anti/equivalences)
-        // 2) abc...z + 1 = 0
-        // 3) mono1 + mono2 = 0/1 [ Not done ]
-        if (poly.deg() == 1 || (poly.isPair() && poly.hasConstantPart())) {
+        // 2) abc...z + 1 = 0 and x*m + x = 0
+        // 3) Equations in two variables, i.e. binary clauses
+        // 4) mono1 + mono2 = 0/1 in general [ Not done ]
+        uint32_t x;
+        if (poly.deg() == 1 || (poly.isPair() && poly.hasConstantPart())
+            || is_implication_pair(poly, x) || poly.nUsedVariables() == 2
+        ) {
             loop_learnt.push_back(poly);
         }
     }
@@ -0,0 +1,78 @@
+/*****************************************************************************
+Copyright (C) 2016  Security Research Labs
+Copyright (C) 2018  Mate Soos, Davin Choo, Kian Ming A. Chai, DSO National Laboratories
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***********************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace BLib {
+
+using std::vector;
+
+// An equation in the shape it was written in, e.g. (x1 + x2)*(x3 + 1) + x4,
+// without expanding it. Each node is a sum of terms plus a constant, and a
+// term is a product of variables and of other (bracketed) nodes. nodes[0] is
+// the whole equation; a node only refers to nodes with higher indices.
+class FactoredPoly
+{
+   public:
+    struct Term {
+        vector<uint32_t> vars;
+        vector<size_t> subs; ///<bracketed nodes multiplied in
+    };
+
+    struct Node {
+        vector<Term> terms;
+        bool constant = false;
+    };
+
+    vector<Node> nodes;
+
+    // Whether there is any bracket left, i.e. whether this is not simply a
+    // sum of monomials
+    bool isFactored() const
+    {
+        for (const Term& t : nodes[0].terms) {
+            if (!t.subs.empty()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Number of variable occurrences, to compare against the expanded form
+    size_t size() const
+    {
+        size_t ret = 0;
+        for (const Node& n : nodes) {
+            for (const Term& t : n.terms) {
+                ret += t.vars.size() + t.subs.size();
+            }
+        }
+        return ret;
+    }
+};
+
+}
@@ -0,0 +1,450 @@
+/*****************************************************************************
+Copyright (C) 2018  Mate Soos, Davin Choo, Kian Ming A. Chai, DSO National Laboratories
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***********************************************/
+
+
+#include "filereader.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+#include <zlib.h>
+#ifdef USE_LZMA
+#include <lzma.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
+using std::cout;
+using std::endl;
+
+using namespace BLib;
+
+MappedFile::MappedFile(const std::string& fname)
+{
+    const int fd = open(fname.c_str(), O_RDONLY);
+    if (fd < 0) {
+        cout << "Problem opening file: \"" << fname << "\" for reading\n";
+        exit(-1);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        cout << "Problem reading size of file: \"" << fname << "\"\n";
+        exit(-1);
+    }
+    len = st.st_size;
+
+    // mmap() refuses zero-length mappings, an empty file is just empty
+    if (len > 0) {
+        void* p = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            cout << "Problem memory-mapping file: \"" << fname << "\"\n";
+            exit(-1);
+        }
+        madvise(p, len, MADV_SEQUENTIAL);
+        ptr = (const char*)p;
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (ptr != nullptr) {
+        munmap((void*)ptr, len);
+    }
+}
+
+RawInput::RawInput(const std::string& _fname) : fname(_fname)
+{
+    fd = (fname == "-") ? STDIN_FILENO : open(fname.c_str(), O_RDONLY);
+    if (fd < 0) {
+        cout << "Problem opening file: \"" << fname << "\" for reading\n";
+        exit(-1);
+    }
+
+    struct stat st;
+    regular = fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+}
+
+RawInput::~RawInput()
+{
+    if (fd != STDIN_FILENO) {
+        close(fd);
+    }
+}
+
+size_t RawInput::readFd(char* buf, const size_t n)
+{
+    while (true) {
+        const ssize_t ret = ::read(fd, buf, n);
+        if (ret >= 0) {
+            return ret;
+        }
+        if (errno != EINTR) {
+            cout << "Problem reading file: \"" << fname << "\"\n";
+            exit(-1);
+        }
+    }
+}
+
+size_t RawInput::read(char* buf, const size_t n)
+{
+    if (peekPos < peeked.size()) {
+        const size_t num = std::min(n, peeked.size() - peekPos);
+        memcpy(buf, peeked.data() + peekPos, num);
+        peekPos += num;
+        return num;
+    }
+    return readFd(buf, n);
+}
+
+size_t RawInput::peek(char* buf, const size_t n)
+{
+    assert(peekPos == 0);
+    // A pipe may hand over fewer bytes than asked for
+    while (peeked.size() < n) {
+        const size_t have = peeked.size();
+        peeked.resize(n);
+        const size_t got = readFd(peeked.data() + have, n - have);
+        peeked.resize(have + got);
+        if (got == 0) {
+            break;
+        }
+    }
+    memcpy(buf, peeked.data(), peeked.size());
+    return peeked.size();
+}
+
+Compression BLib::detect_compression(RawInput& in)
+{
+    unsigned char magic[6];
+    const size_t n = in.peek((char*)magic, sizeof(magic));
+
+    if (n >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+        return Compression::gzip;
+    }
+    if (n >= 6 && memcmp(magic, "\xfd" "7zXZ\0", 6) == 0) {
+        return Compression::xz;
+    }
+    if (n >= 4 && memcmp(magic, "\x28\xb5\x2f\xfd", 4) == 0) {
+        return Compression::zstd;
+    }
+    return Compression::none;
+}
+
+DecompressingReader::DecompressingReader(RawInput& _in,
+                                         const Compression _comp)
+    : in(_in), comp(_comp)
+{
+#ifndef USE_LZMA
+    if (comp == Compression::xz) {
+        cout << "ERROR: file \"" << in.name() << "\" is xz-compressed, but this "
+             << "binary was built without xz support" << endl;
+        exit(-1);
+    }
+#endif
+#ifndef USE_ZSTD
+    if (comp == Compression::zstd) {
+        cout << "ERROR: file \"" << in.name() << "\" is zstd-compressed, but "
+             << "this binary was built without zstd support" << endl;
+        exit(-1);
+    }
+#endif
+    worker = std::thread(&DecompressingReader::run, this);
+}
+
+DecompressingReader::~DecompressingReader()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    cond.notify_all();
+    worker.join();
+}
+
+bool DecompressingReader::next(std::vector<char>& block)
+{
+    std::unique_lock<std::mutex> lock(mtx);
+    cond.wait(lock, [this] { return !queue.empty() || finished; });
+    if (queue.empty()) {
+        return false;
+    }
+    block.swap(queue.front());
+    queue.pop_front();
+    lock.unlock();
+    cond.notify_all();
+    return true;
+}
+
+bool DecompressingReader::push(std::vector<char>& block)
+{
+    std::unique_lock<std::mutex> lock(mtx);
+    cond.wait(lock, [this] { return queue.size() < max_queued || stopping; });
+    if (stopping) {
+        return false;
+    }
+    queue.push_back(std::vector<char>());
+    queue.back().swap(block);
+    lock.unlock();
+    cond.notify_all();
+    return true;
+}
+
+void DecompressingReader::run()
+{
+    switch (comp) {
+        case Compression::gzip:
+            run_gzip();
+            break;
+        case Compression::xz:
+            run_xz();
+            break;
+        case Compression::zstd:
+            run_zstd();
+            break;
+        case Compression::none:
+            assert(false);
+            break;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        finished = true;
+    }
+    cond.notify_all();
+}
+
+void DecompressingReader::run_gzip()
+{
+    // inflate() rather than gzread(), since the input may be a pipe
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    if (inflateInit2(&strm, 16 + MAX_WBITS) != Z_OK) {
+        cout << "ERROR: cannot initialize gzip decoder" << endl;
+        exit(-1);
+    }
+
+    std::vector<char> inbuf(1 << 17);
+    std::vector<char> block(block_size);
+    strm.next_out = (Bytef*)block.data();
+    strm.avail_out = block.size();
+    bool eof = false;
+    bool stop = false;
+    while (!stop) {
+        if (strm.avail_in == 0 && !eof) {
+            strm.next_in = (Bytef*)inbuf.data();
+            strm.avail_in = in.read(inbuf.data(), inbuf.size());
+            eof = strm.avail_in == 0;
+        }
+
+        const int ret = inflate(&strm, Z_NO_FLUSH);
+        if (ret == Z_BUF_ERROR && eof) {
+            cout << "ERROR: problem decompressing \"" << in.name()
+                 << "\": unexpected end of file" << endl;
+            exit(-1);
+        }
+        if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+            cout << "ERROR: problem decompressing \"" << in.name()
+                 << "\": " << (strm.msg ? strm.msg : "gzip error") << endl;
+            exit(-1);
+        }
+
+        if (strm.avail_out == 0 || ret == Z_STREAM_END) {
+            block.resize(block.size() - strm.avail_out);
+            if (!block.empty() && !push(block)) {
+                stop = true;
+            }
+            block.resize(block_size);
+            strm.next_out = (Bytef*)block.data();
+            strm.avail_out = block.size();
+        }
+
+        // Like gunzip, carry on with the next member of concatenated files
+        if (ret == Z_STREAM_END) {
+            if (strm.avail_in == 0) {
+                strm.next_in = (Bytef*)inbuf.data();
+                strm.avail_in = in.read(inbuf.data(), inbuf.size());
+                eof = strm.avail_in == 0;
+            }
+            if (eof) {
+                stop = true;
+            } else {
+                inflateReset(&strm);
+            }
+        }
+    }
+    inflateEnd(&strm);
+}
+
+void DecompressingReader::run_xz()
+{
+#ifdef USE_LZMA
+    lzma_stream strm = LZMA_STREAM_INIT;
+    if (lzma_stream_decoder(&strm, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK) {
+        cout << "ERROR: cannot initialize xz decoder" << endl;
+        exit(-1);
+    }
+
+    std::vector<uint8_t> inbuf(1 << 17);
+    std::vector<char> block(block_size);
+    strm.next_out = (uint8_t*)block.data();
+    strm.avail_out = block.size();
+    lzma_action action = LZMA_RUN;
+    bool stop = false;
+    while (!stop) {
+        if (strm.avail_in == 0 && action == LZMA_RUN) {
+            strm.next_in = inbuf.data();
+            strm.avail_in = in.read((char*)inbuf.data(), inbuf.size());
+            if (strm.avail_in == 0) {
+                action = LZMA_FINISH;
+            }
+        }
+
+        const lzma_ret ret = lzma_code(&strm, action);
+        if (ret != LZMA_OK && ret != LZMA_STREAM_END) {
+            cout << "ERROR: problem decompressing \"" << in.name()
+                 << "\", xz error code " << ret << endl;
+            exit(-1);
+        }
+
+        if (strm.avail_out == 0 || ret == LZMA_STREAM_END) {
+            block.resize(block.size() - strm.avail_out);
+            if (!block.empty() && !push(block)) {
+                stop = true;
+            }
+            block.resize(block_size);
+            strm.next_out = (uint8_t*)block.data();
+            strm.avail_out = block.size();
+        }
+        if (ret == LZMA_STREAM_END) {
+            stop = true;
+        }
+    }
+    lzma_end(&strm);
+#endif
+}
+
+void DecompressingReader::run_zstd()
+{
+#ifdef USE_ZSTD
+    ZSTD_DStream* strm = ZSTD_createDStream();
+    ZSTD_initDStream(strm);
+    std::vector<char> inbuf(ZSTD_DStreamInSize());
+    std::vector<char> block;
+    bool stop = false;
+    bool eof = false;
+    size_t ret = 0; // 0 once a frame is fully decoded and flushed
+    while (!stop && !eof) {
+        const size_t n = in.read(inbuf.data(), inbuf.size());
+        eof = (n == 0);
+        ZSTD_inBuffer input = {inbuf.data(), n, 0};
+
+        // A full output block means the decoder may hold more, even once
+        // the input is used up
+        bool more = true;
+        while (!stop && more) {
+            block.resize(block_size);
+            ZSTD_outBuffer output = {block.data(), block.size(), 0};
+            ret = ZSTD_decompressStream(strm, &output, &input);
+            if (ZSTD_isError(ret)) {
+                cout << "ERROR: problem decompressing \"" << in.name()
+                     << "\": " << ZSTD_getErrorName(ret) << endl;
+                exit(-1);
+            }
+            more = input.pos < input.size || output.pos == output.size;
+            block.resize(output.pos);
+            if (!block.empty() && !push(block)) {
+                stop = true;
+            }
+        }
+    }
+    if (!stop && ret != 0) {
+        cout << "ERROR: problem decompressing \"" << in.name()
+             << "\": unexpected end of file" << endl;
+        exit(-1);
+    }
+    ZSTD_freeDStream(strm);
+#endif
+}
+
+void BLib::read_lines(
+    const std::string& fname,
+    const std::function<void(const char*, const char*)>& parse)
+{
+    RawInput in(fname);
+    const Compression comp = detect_compression(in);
+    if (comp == Compression::none && in.isRegular() && fname != "-") {
+        MappedFile file(fname);
+        parse(file.data(), file.data() + file.size());
+        return;
+    }
+
+    std::unique_ptr<DecompressingReader> reader;
+    if (comp != Compression::none) {
+        reader.reset(new DecompressingReader(in, comp));
+    }
+    auto next = [&](std::vector<char>& block) {
+        if (reader) {
+            return reader->next(block);
+        }
+        block.resize(1 << 20);
+        block.resize(in.read(block.data(), block.size()));
+        return !block.empty();
+    };
+
+    // Complete lines go to the parser, the unfinished last one is kept
+    // until the rest of it arrives in a later block
+    std::vector<char> block;
+    std::vector<char> pending;
+    while (next(block)) {
+        const char* beg = block.data();
+        const char* end = beg + block.size();
+        const char* last = (const char*)memrchr(beg, '\n', block.size());
+        if (last == NULL) {
+            pending.insert(pending.end(), beg, end);
+            continue;
+        }
+
+        if (!pending.empty()) {
+            const char* eol = (const char*)memchr(beg, '\n', end - beg);
+            pending.insert(pending.end(), beg, eol + 1);
+            parse(pending.data(), pending.data() + pending.size());
+            beg = eol + 1;
+        }
+        parse(beg, last + 1);
+        pending.assign(last + 1, end);
+    }
+    if (!pending.empty()) {
+        parse(pending.data(), pending.data() + pending.size());
+    }
+}
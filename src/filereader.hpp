@@ -0,0 +1,147 @@
+/*****************************************************************************
+Copyright (C) 2018  Mate Soos, Davin Choo, Kian Ming A. Chai, DSO National Laboratories
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***********************************************/
+
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace BLib {
+
+// Read-only view of a whole input file, memory-mapped so that parsers can
+// tokenize it in place without copying it into std::strings first.
+class MappedFile
+{
+   public:
+    explicit MappedFile(const std::string& fname);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const
+    {
+        return ptr;
+    }
+
+    size_t size() const
+    {
+        return len;
+    }
+
+   private:
+    const char* ptr = nullptr;
+    size_t len = 0;
+};
+
+// Sequential reader of a file, a pipe, or stdin if the name is "-"
+class RawInput
+{
+   public:
+    explicit RawInput(const std::string& fname);
+    ~RawInput();
+    RawInput(const RawInput&) = delete;
+    RawInput& operator=(const RawInput&) = delete;
+
+    // Regular files can be memory-mapped instead of read
+    bool isRegular() const
+    {
+        return regular;
+    }
+
+    const std::string& name() const
+    {
+        return fname;
+    }
+
+    // Reads at most 'n' bytes, returns 0 at the end of the input
+    size_t read(char* buf, size_t n);
+
+    // Gets the first 'n' bytes without consuming them, so that they can
+    // be looked at even when the input is a pipe
+    size_t peek(char* buf, size_t n);
+
+   private:
+    size_t readFd(char* buf, size_t n);
+
+    const std::string fname;
+    int fd = -1;
+    bool regular = false;
+    std::vector<char> peeked; ///<read by peek(), not yet by read()
+    size_t peekPos = 0;
+};
+
+enum class Compression { none, gzip, xz, zstd };
+
+// Looks at the magic bytes at the start of the input
+Compression detect_compression(RawInput& in);
+
+// Decompresses the input on a separate thread, which hands over blocks of
+// decompressed data through a bounded queue.
+class DecompressingReader
+{
+   public:
+    DecompressingReader(RawInput& in, Compression comp);
+    ~DecompressingReader();
+    DecompressingReader(const DecompressingReader&) = delete;
+    DecompressingReader& operator=(const DecompressingReader&) = delete;
+
+    // Gets the next block, returns false at the end of the input
+    bool next(std::vector<char>& block);
+
+   private:
+    void run();
+    void run_gzip();
+    void run_xz();
+    void run_zstd();
+
+    // Blocks while the queue is full. Returns false if the reader is going
+    // away and decompression should stop.
+    bool push(std::vector<char>& block);
+
+    static const size_t block_size = 1 << 20;
+    static const size_t max_queued = 8;
+
+    RawInput& in;
+    const Compression comp;
+    std::thread worker;
+    std::mutex mtx;
+    std::condition_variable cond;
+    std::deque<std::vector<char> > queue;
+    bool finished = false; ///<worker has pushed everything
+    bool stopping = false; ///<consumer is not interested any more
+};
+
+// Calls parse(beg, end) on consecutive pieces of the file, each made of
+// complete lines. Plain regular files are mapped and passed in one piece;
+// compressed files, pipes and stdin ("-") are streamed.
+void read_lines(const std::string& fname,
+                const std::function<void(const char*, const char*)>& parse);
+
+}
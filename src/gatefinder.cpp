@@ -0,0 +1,242 @@
+/*****************************************************************************
+Copyright (C) 2018  Mate Soos, Davin Choo, Kian Ming A. Chai, DSO National Laboratories
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***********************************************/
+
+#include <algorithm>
+#include <limits>
+
+#include "gatefinder.hpp"
+
+USING_NAMESPACE_PBORI
+
+using namespace BLib;
+using Bosph::Clause;
+using CMSat::lit_Undef;
+
+static const uint32_t none = std::numeric_limits<uint32_t>::max();
+
+static BoolePolynomial lit_to_poly(const Lit l, const BoolePolyRing& ring)
+{
+    BoolePolynomial p(BooleVariable(l.var(), ring));
+    if (l.sign()) {
+        p += BoolePolynomial(true, ring);
+    }
+    return p;
+}
+
+BoolePolynomial BLib::gate_to_poly(const Gate& gate, const BoolePolyRing& ring)
+{
+    BoolePolynomial ret = lit_to_poly(gate.out, ring);
+    if (gate.type == Gate::Type::and_gate) {
+        BoolePolynomial prod(true, ring);
+        for (const Lit l : gate.ins) {
+            prod *= lit_to_poly(l, ring);
+        }
+        ret += prod;
+    } else {
+        // z = c*t + (c+1)*e
+        const BoolePolynomial c = lit_to_poly(gate.ins[0], ring);
+        const BoolePolynomial t = lit_to_poly(gate.ins[1], ring);
+        const BoolePolynomial e = lit_to_poly(gate.ins[2], ring);
+        ret += c * (t + e) + e;
+    }
+    return ret;
+}
+
+GateFinder::GateFinder(const vector<Clause>& _clauses, const uint32_t numVars,
+                       const uint32_t _maxNegInputs)
+    : clauses(_clauses), maxNegInputs(_maxNegInputs)
+{
+    binOcc.resize(numVars * 2);
+    ternOcc.resize(numVars * 2);
+    mark.resize(numVars * 2, none);
+    varStamp.resize(numVars, 0);
+    covered.resize(clauses.size(), 0);
+
+    for (uint32_t i = 0; i < clauses.size(); i++) {
+        const vector<Lit>& lits = clauses[i].getLits();
+        if (lits.size() == 2) {
+            binOcc[lits[0].toInt()].push_back(std::make_pair(lits[1], i));
+            binOcc[lits[1].toInt()].push_back(std::make_pair(lits[0], i));
+        } else if (lits.size() == 3) {
+            for (const Lit l : lits) {
+                ternOcc[l.toInt()].push_back(i);
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < clauses.size(); i++) {
+        const vector<Lit>& lits = clauses[i].getLits();
+        if (lits.size() < 3 || covered[i] || !hasDistinctVars(lits)) {
+            continue;
+        }
+        findAnd(i);
+        if (!covered[i] && lits.size() == 3) {
+            findIte(i);
+        }
+    }
+}
+
+bool GateFinder::hasDistinctVars(const vector<Lit>& lits)
+{
+    stamp++;
+    for (const Lit l : lits) {
+        if (varStamp[l.var()] == stamp) {
+            return false;
+        }
+        varStamp[l.var()] = stamp;
+    }
+    return true;
+}
+
+void GateFinder::cover(const uint32_t clauseIdx)
+{
+    if (!covered[clauseIdx]) {
+        covered[clauseIdx] = 1;
+        numCovered++;
+    }
+}
+
+// z = l1 & ... & lk is (z | ~l1 | ... | ~lk) plus the binaries (~z | li)
+void GateFinder::findAnd(const uint32_t clauseIdx)
+{
+    const vector<Lit>& lits = clauses[clauseIdx].getLits();
+    for (const Lit z : lits) {
+        const auto& partners = binOcc[(~z).toInt()];
+        if (partners.size() < lits.size() - 1) {
+            continue;
+        }
+
+        for (const auto& p : partners) {
+            mark[p.first.toInt()] = p.second;
+        }
+        bool found = true;
+        uint32_t numNeg = 0;
+        for (const Lit m : lits) {
+            if (m == z) {
+                continue;
+            }
+            found &= mark[(~m).toInt()] != none;
+            numNeg += !m.sign();
+        }
+
+        if (found && numNeg <= maxNegInputs) {
+            Gate gate;
+            gate.type = Gate::Type::and_gate;
+            gate.out = z;
+            for (const Lit m : lits) {
+                if (m != z) {
+                    gate.ins.push_back(~m);
+                    cover(mark[(~m).toInt()]);
+                }
+            }
+            cover(clauseIdx);
+            gates.push_back(gate);
+            numAnd++;
+        }
+
+        for (const auto& p : partners) {
+            mark[p.first.toInt()] = none;
+        }
+        if (covered[clauseIdx]) {
+            return;
+        }
+    }
+}
+
+uint32_t GateFinder::findTernary(const Lit a, const Lit b, const Lit c) const
+{
+    // The rarest literal has the shortest list to look through
+    const vector<uint32_t>* occ = &ternOcc[a.toInt()];
+    if (ternOcc[b.toInt()].size() < occ->size()) {
+        occ = &ternOcc[b.toInt()];
+    }
+    if (ternOcc[c.toInt()].size() < occ->size()) {
+        occ = &ternOcc[c.toInt()];
+    }
+
+    for (const uint32_t idx : *occ) {
+        const vector<Lit>& lits = clauses[idx].getLits();
+        if (std::find(lits.begin(), lits.end(), a) != lits.end()
+            && std::find(lits.begin(), lits.end(), b) != lits.end()
+            && std::find(lits.begin(), lits.end(), c) != lits.end()
+        ) {
+            return idx;
+        }
+    }
+    return none;
+}
+
+// z = ITE(c, t, e) is (~c | ~t | z), (~c | t | ~z), (c | ~e | z), (c | e | ~z)
+void GateFinder::findIte(const uint32_t clauseIdx)
+{
+    const vector<Lit>& lits = clauses[clauseIdx].getLits();
+    for (uint32_t ci = 0; ci < 3; ci++) {
+        for (uint32_t zi = 0; zi < 3; zi++) {
+            if (ci == zi) {
+                continue;
+            }
+            const Lit c = ~lits[ci];
+            const Lit z = lits[zi];
+            const Lit t = ~lits[3 - ci - zi];
+
+            const uint32_t thenIdx = findTernary(~c, t, ~z);
+            if (thenIdx == none) {
+                continue;
+            }
+
+            for (const uint32_t idx : ternOcc[c.toInt()]) {
+                const vector<Lit>& other = clauses[idx].getLits();
+                if (std::find(other.begin(), other.end(), ~z) == other.end()) {
+                    continue;
+                }
+                Lit e = lit_Undef;
+                for (const Lit l : other) {
+                    if (l != c && l != ~z) {
+                        e = l;
+                    }
+                }
+                if (e == lit_Undef || e.var() == c.var() || e.var() == t.var()
+                    || e.var() == z.var()
+                ) {
+                    continue;
+                }
+
+                const uint32_t elseIdx = findTernary(c, ~e, z);
+                if (elseIdx == none) {
+                    continue;
+                }
+
+                Gate gate;
+                gate.type = Gate::Type::ite_gate;
+                gate.out = z;
+                gate.ins = {c, t, e};
+                cover(clauseIdx);
+                cover(thenIdx);
+                cover(idx);
+                cover(elseIdx);
+                gates.push_back(gate);
+                numIte++;
+                return;
+            }
+        }
+    }
+}
@@ -0,0 +1,107 @@
+/*****************************************************************************
+Copyright (C) 2018  Mate Soos, Davin Choo, Kian Ming A. Chai, DSO National Laboratories
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***********************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "bosphincludes.hpp"
+#include <polybori/polybori.h>
+
+namespace BLib {
+
+// Output literal defined by a Tseitin-encoded gate over the input literals.
+// For ITE gates the inputs are {condition, then, else}.
+struct Gate {
+    enum class Type { and_gate, ite_gate };
+    Type type;
+    Lit out;
+    std::vector<Lit> ins;
+};
+
+// The equation equivalent to the gate's clauses, e.g. z + a*b for z = a & b
+polybori::BoolePolynomial gate_to_poly(const Gate& gate,
+                                       const polybori::BoolePolyRing& ring);
+
+// Finds AND and ITE gates among the clauses of a CNF, through occurrence
+// lists of binary and ternary clauses. The clauses of a gate are equivalent
+// to its equation, so the covered clauses need not be imported separately.
+class GateFinder
+{
+   public:
+    // AND gates with more than 'maxNegInputs' negated inputs are skipped,
+    // since their equation expands to 2^(negated inputs) monomials
+    GateFinder(const std::vector<Bosph::Clause>& clauses, uint32_t numVars,
+               uint32_t maxNegInputs);
+
+    const std::vector<Gate>& getGates() const
+    {
+        return gates;
+    }
+
+    bool isCovered(const size_t clauseIdx) const
+    {
+        return covered[clauseIdx];
+    }
+
+    size_t getNumAnd() const
+    {
+        return numAnd;
+    }
+
+    size_t getNumIte() const
+    {
+        return numIte;
+    }
+
+    size_t getNumCovered() const
+    {
+        return numCovered;
+    }
+
+   private:
+    void findAnd(uint32_t clauseIdx);
+    void findIte(uint32_t clauseIdx);
+    bool hasDistinctVars(const std::vector<Lit>& lits);
+    uint32_t findTernary(Lit a, Lit b, Lit c) const;
+    void cover(uint32_t clauseIdx);
+
+    const std::vector<Bosph::Clause>& clauses;
+    const uint32_t maxNegInputs;
+
+    // Indexed by Lit::toInt(): the binary clauses as (other lit, clause),
+    // and the ternary clauses the literal is in
+    std::vector<std::vector<std::pair<Lit, uint32_t> > > binOcc;
+    std::vector<std::vector<uint32_t> > ternOcc;
+
+    std::vector<uint32_t> mark; ///<per literal, scratch for findAnd()
+    std::vector<uint32_t> varStamp;
+    uint32_t stamp = 0;
+
+    std::vector<char> covered;
+    std::vector<Gate> gates;
+    size_t numAnd = 0;
+    size_t numIte = 0;
+    size_t numCovered = 0;
+};
+
+}
@@ -0,0 +1,159 @@
+/*****************************************************************************
+Copyright (C) 2018  Mate Soos, Davin Choo, Kian Ming A. Chai, DSO National Laboratories
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***********************************************/
+
+#include "linearengine.hpp"
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+using std::vector;
+using namespace BLib;
+
+static const uint32_t noRow = std::numeric_limits<uint32_t>::max();
+
+// 32MB worth of rows
+static const size_t maxWords = 1 << 22;
+
+LinearEngine::LinearEngine(const size_t numVars) : colOf(numVars, noCol)
+{
+}
+
+void LinearEngine::xorRow(uint64_t* to, const uint64_t* from) const
+{
+    for (size_t w = 0; w < words; w++) {
+        to[w] ^= from[w];
+    }
+}
+
+// Gives 'var' a column, widening the rows if needed. Returns false if the
+// rows would not fit in the memory limit.
+bool LinearEngine::makeCol(const uint32_t var)
+{
+    if (varOf.size() == words * 64) {
+        const size_t newWords = std::max<size_t>(1, 2 * words);
+        if (std::max<size_t>(pivot.size(), 1) * newWords > maxWords) {
+            return false;
+        }
+        vector<uint64_t> wider(pivot.size() * newWords, 0);
+        for (size_t r = 0; r < pivot.size(); r++) {
+            std::copy(bits.begin() + r * words, bits.begin() + (r + 1) * words,
+                      wider.begin() + r * newWords);
+        }
+        bits.swap(wider);
+        words = newWords;
+        tmp.resize(words);
+    }
+    colOf[var] = varOf.size();
+    varOf.push_back(var);
+    pivotRow.push_back(noRow);
+    return true;
+}
+
+void LinearEngine::checkFact(const size_t r, vector<LinearFact>& facts) const
+{
+    const uint64_t* const at = bits.data() + r * words;
+    LinearFact fact;
+    fact.num = 0;
+    fact.rhs = rhs[r];
+    for (size_t w = 0; w < words; w++) {
+        uint64_t word = at[w];
+        while (word != 0) {
+            if (fact.num == 2) {
+                return;
+            }
+            fact.vars[fact.num++] = varOf[w * 64 + __builtin_ctzll(word)];
+            word &= word - 1;
+        }
+    }
+    assert(fact.num > 0);
+    facts.push_back(fact);
+}
+
+bool LinearEngine::add(const vector<uint32_t>& vars, bool c,
+                       vector<LinearFact>& facts)
+{
+    if (full) {
+        return true;
+    }
+
+    for (const uint32_t v : vars) {
+        assert(v < colOf.size());
+        if (colOf[v] == noCol && !makeCol(v)) {
+            full = true;
+            return true;
+        }
+    }
+    std::fill(tmp.begin(), tmp.end(), 0);
+    for (const uint32_t v : vars) {
+        const uint32_t col = colOf[v];
+        tmp[col / 64] ^= 1ULL << (col % 64);
+    }
+
+    // Reduce by the rows. These only have their own pivot column, so the
+    // pivot columns to go through are the ones set at the start.
+    for (size_t w = 0; w < words; w++) {
+        uint64_t word = tmp[w];
+        while (word != 0) {
+            const uint32_t col = w * 64 + __builtin_ctzll(word);
+            word &= word - 1;
+            const uint32_t r = pivotRow[col];
+            if (r != noRow) {
+                xorRow(tmp.data(), row(r));
+                c ^= rhs[r];
+            }
+        }
+    }
+
+    uint32_t p = noRow;
+    for (size_t w = 0; w < words && p == noRow; w++) {
+        if (tmp[w] != 0) {
+            p = w * 64 + __builtin_ctzll(tmp[w]);
+        }
+    }
+    if (p == noRow) {
+        // 0 = 1, or nothing new
+        return !c;
+    }
+
+    if ((pivot.size() + 1) * words > maxWords) {
+        full = true;
+        return true;
+    }
+
+    // Keep the form reduced: the new pivot column is cleared in all rows
+    const uint64_t mask = 1ULL << (p % 64);
+    for (size_t r = 0; r < pivot.size(); r++) {
+        uint64_t* const at = row(r);
+        if (at[p / 64] & mask) {
+            xorRow(at, tmp.data());
+            rhs[r] ^= c;
+            checkFact(r, facts);
+        }
+    }
+
+    bits.insert(bits.end(), tmp.begin(), tmp.end());
+    rhs.push_back(c);
+    pivot.push_back(p);
+    pivotRow[p] = pivot.size() - 1;
+    checkFact(pivot.size() - 1, facts);
+    return true;
+}
@@ -0,0 +1,101 @@
+/*****************************************************************************
+Copyright (C) 2018  Mate Soos, Davin Choo, Kian Ming A. Chai, DSO National Laboratories
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***********************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace BLib {
+
+// A row of the system with at most two variables: vars[0] = rhs, or
+// vars[0] + vars[1] = rhs
+struct LinearFact {
+    uint32_t vars[2];
+    uint32_t num;
+    bool rhs;
+};
+
+// The linear equations of the ANF in reduced row echelon form, one
+// bit-packed row per equation. Equations are added one at a time, and every
+// row that drops to one or two variables on the way is reported, so that
+// the value or (anti)equivalence it gives can go to the Replacer. Columns
+// are only made for the variables that occur in the equations, so the
+// rows are as wide as the part of the ring the XORs touch.
+class LinearEngine
+{
+   public:
+    explicit LinearEngine(size_t numVars);
+
+    // Adds the equation "sum of vars = rhs", a variable may be listed twice.
+    // Returns false if the system has no solution.
+    bool add(const std::vector<uint32_t>& vars, bool rhs,
+             std::vector<LinearFact>& facts);
+
+    // Whether 'var' was in some equation added so far. Values and
+    // replacements of other variables do not concern the engine.
+    bool hasVar(const uint32_t var) const
+    {
+        return colOf[var] != noCol;
+    }
+
+    size_t numRows() const
+    {
+        return pivot.size();
+    }
+
+    size_t numCols() const
+    {
+        return varOf.size();
+    }
+
+    // Set once the rows would take up more than the memory limit (32MB),
+    // after which equations are ignored
+    bool isFull() const
+    {
+        return full;
+    }
+
+   private:
+    static constexpr uint32_t noCol = UINT32_MAX;
+
+    uint64_t* row(const size_t r)
+    {
+        return bits.data() + r * words;
+    }
+    void xorRow(uint64_t* to, const uint64_t* from) const;
+    void checkFact(size_t r, std::vector<LinearFact>& facts) const;
+    bool makeCol(uint32_t var);
+
+    size_t words = 0; ///<words per row
+    std::vector<uint64_t> bits;
+    std::vector<char> rhs;
+    std::vector<uint32_t> pivot;    ///<pivot column of each row
+    std::vector<uint32_t> pivotRow; ///<row of each pivot column, or none
+    std::vector<uint32_t> colOf;    ///<column of each var, or noCol
+    std::vector<uint32_t> varOf;    ///<var of each column
+    std::vector<uint64_t> tmp;
+    bool full = false;
+};
+
+}
@@ -44,6 +44,8 @@ namespace po = boost::program_options;
 //inputs and outputs
 string anfInput;
 string anfOutput;
+string anfBinInput;
+string anfBinOutput;
 string cnfInput;
 string cnfOutput;
 string solution_output_file;
@@ -53,8 +55,10 @@ string solmap_file_write;
 
 // read/write
 bool readANF;
+bool readANFBin;
 bool readCNF;
 bool writeANF;
+bool writeANFBin;
 bool writeCNF;
 bool solve_with_cms;
 bool all_solutions;
@@ -85,10 +89,12 @@ void parseOptions(int argc, char* argv[])
     ("help,h", "produce help message")
     ("version", "print version number and exit")
     // Input/Output
-    ("anfread", po::value(&anfInput), "Read ANF from this file")
-    ("cnfread", po::value(&cnfInput), "Read CNF from this file")
+    ("anfread", po::value(&anfInput), "Read ANF from this file, or stdin if \"-\" (may be gzip/xz/zstd compressed)")
+    ("cnfread", po::value(&cnfInput), "Read CNF from this file, or stdin if \"-\" (may be gzip/xz/zstd compressed)")
     ("anfwrite", po::value(&anfOutput), "Write ANF output to file")
     ("cnfwrite", po::value(&cnfOutput), "Write CNF output to file")
+    ("anfread-bin", po::value(&anfBinInput), "Read binary ANF checkpoint (with fixed/replaced vars and learnt facts) from this file")
+    ("anfwrite-bin", po::value(&anfBinOutput), "Write binary ANF checkpoint to file")
     ("verb,v", po::value<uint32_t>(&config.verbosity)->default_value(config.verbosity),
      "Verbosity setting: 0(slient) - 3(noisy)")
     ("simplify", po::value<int>(&config.simplify)->default_value(config.simplify),
@@ -99,6 +105,8 @@ void parseOptions(int argc, char* argv[])
     ("maxsol", po::value(&max_sol)->default_value(max_sol), "Find at most this many solutions")
     ("maxiters", po::value(&maxiters)->default_value(maxiters),
      "Maximum iterations to simplify")
+    ("renumber", po::bool_switch(&config.renumber),
+     "Renumber the variables of the ANF input to a dense range. Output still uses the original numbering, except for the CNF's own variables")
 
     // Processes
     ("maxtime", po::value(&config.maxTime)->default_value(config.maxTime, maxTime_str.str()),
@@ -112,6 +120,10 @@ void parseOptions(int argc, char* argv[])
     cnf_conv_options.add_options()
     ("cutnum", po::value<uint32_t>(&config.cutNum)->default_value(config.cutNum),
      "Cutting number when not using XOR clauses")
+    ("gates", po::value(&config.findGates)->default_value(config.findGates),
+     "Import AND/ITE gates of the CNF as one equation each, instead of one per clause")
+    ("xorfind", po::value(&config.xorFindMax)->default_value(config.xorFindMax),
+     "Import XORs of the CNF up to this size, that are encoded as clauses, as linear equations. 0 = off")
     ("karn", po::value(&config.brickestein_algo_cutoff)->default_value(config.brickestein_algo_cutoff),
      "Uses this cutoff for doing Brickenstein's algorithm for translation of complex ANFs")
     ("onlynewcnfcls", po::value(&only_new_cnf_clauses)->default_value(only_new_cnf_clauses),
@@ -144,7 +156,7 @@ void parseOptions(int argc, char* argv[])
     ("satlim", po::value<uint64_t>(&config.numConfl_lim)->default_value(config.numConfl_lim),
      "Conflict limit for built-in SAT solver.")
     ("threads,t", po::value<unsigned int>(&config.numThreads)->default_value(config.numThreads),
-     "Number of threads to use for SAT solver (same value is used for built-in and external).")
+     "Number of threads to use for SAT solver (same value is used for built-in and external) and for reading large ANF files.")
     ("solmap", po::value(&solmap_file_write), "Write solution map to this file")
     ;
 
@@ -215,23 +227,33 @@ void parseOptions(int argc, char* argv[])
     if (vm.count("cnfread")) {
         readCNF = true;
     }
+    if (vm.count("anfread-bin")) {
+        readANFBin = true;
+    }
     if (vm.count("anfwrite")) {
         writeANF = true;
     }
     if (vm.count("cnfwrite")) {
         writeCNF = true;
     }
+    if (vm.count("anfwrite-bin")) {
+        writeANFBin = true;
+    }
 
     if (vm.count("solvewrite")) {
         solve_with_cms = true;
     }
 
-    if (readANF && readCNF) {
-        cout << "You cannot give both ANF/CNF files to read in\n";
+    if ((int)readANF + (int)readCNF + (int)readANFBin > 1) {
+        cout << "You cannot give more than one ANF/CNF file to read in\n";
         exit(-1);
     }
 
     // Config checks
+    if (config.xorFindMax > 20) {
+        cout << "ERROR! For sanity, XORs larger than 20 cannot be looked for\n";
+        exit(-1);
+    }
     if (config.cutNum < 3 || config.cutNum > 10) {
         cout << "ERROR! For sanity, cutting number must be between 3 and 10\n";
         exit(-1);
@@ -305,7 +327,8 @@ void write_solution_to_file(const char* fname, const Solution& solution)
 int main(int argc, char* argv[])
 {
     parseOptions(argc, argv);
-    if (anfInput.length() == 0 && cnfInput.length() == 0) {
+    if (anfInput.length() == 0 && cnfInput.length() == 0 &&
+        anfBinInput.length() == 0) {
         cerr << "c ERROR: you must provide an ANF/CNF input file" << endl;
         exit(-1);
     }
@@ -324,10 +347,18 @@ int main(int argc, char* argv[])
         }
     }
 
+    if (readANFBin) {
+        double parseStartTime = cpuTime();
+        anf = mylib.load_binary(anfBinInput.c_str());
+        if (config.verbosity) {
+            cout << "c [ANF Input] binary read in T: "
+                 << (cpuTime() - parseStartTime) << endl;
+        }
+    }
+
     if (readCNF) {
         double parseStartTime = cpuTime();
-        DIMACS* dimacs = mylib.parse_cnf(cnfInput.c_str());
-        anf = mylib.chunk_dimacs(dimacs);
+        anf = mylib.read_cnf(cnfInput.c_str());
         if (config.verbosity) {
             cout << "c [CNF Input] read in T: " << (cpuTime() - parseStartTime)
                  << endl;
@@ -338,16 +369,8 @@ int main(int argc, char* argv[])
         Bosphorus::print_stats(anf);
     }
 
-    // this is needed to check for test solution and the check if it is really a new learnt fact
-    double myTime = cpuTime();
-    if (config.verbosity) {
-        cout << "c [ANF hash] Calculating ANF hash..." << endl;
-    }
-
-    auto orig_anf = Bosphorus::copy_anf_no_replacer(anf);
-    if (config.verbosity) {
-        cout << "c [ANF hash] Done. T: " << (cpuTime() - myTime) << endl;
-    }
+    // this is needed to check if a learnt fact is really new
+    Bosphorus::snapshot_anf(anf);
 
     if (config.simplify) {
         const char* cnf_orig = NULL;
@@ -366,8 +389,8 @@ int main(int argc, char* argv[])
     }
 
     // finish up the learnt polynomials
-    mylib.add_trivial_learnt_from_anf_to_learnt(anf, orig_anf);
-    Bosphorus::delete_anf(orig_anf);
+    mylib.add_trivial_learnt_from_anf_to_learnt(anf);
+    Bosphorus::drop_snapshot(anf);
 
     // remove duplicates from learnt clauses
     mylib.deduplicate();
@@ -376,6 +399,9 @@ int main(int argc, char* argv[])
     if (writeANF) {
         mylib.write_anf(anfOutput.c_str(), anf);
     }
+    if (writeANFBin) {
+        mylib.save_binary(anfBinOutput.c_str(), anf);
+    }
 
     CNF* cnf = NULL;
     if (writeCNF) {
@@ -431,6 +457,7 @@ Solution extend_solution(
     const std::map<uint32_t, VarMap>& varmap,
     uint32_t num_anf_vars
 );
+Solution to_orig_vars(const Bosph::Bosphorus* mylib, const ANF* anf, const Solution& s);
 
 void solve(Bosph::Bosphorus* mylib, CNF* cnf, ANF* anf) {
     vector<Clause> cls = mylib->get_clauses(cnf);
@@ -458,8 +485,9 @@ void solve(Bosph::Bosphorus* mylib, CNF* cnf, ANF* anf) {
         } else {
             solution.ret = l_False;
         }
-        print_solution_anf_style(solution);
-        write_solution_to_file_cnf_style(solution);
+        const Solution orig_solution = to_orig_vars(mylib, anf, solution);
+        print_solution_anf_style(orig_solution);
+        write_solution_to_file_cnf_style(orig_solution);
         if (ret == CMSat::l_True) {
             check_solution(anf, solution);
         }
@@ -604,6 +632,27 @@ Solution extend_solution(
     return s;
 }
 
+// With --renumber, solutions are printed with the variable indices of the
+// input file
+Solution to_orig_vars(const Bosph::Bosphorus* mylib, const ANF* anf, const Solution& s)
+{
+    if (!config.renumber || s.ret != l_True) {
+        return s;
+    }
+
+    Solution ret;
+    ret.ret = s.ret;
+    for(uint32_t i = 0; i < s.sol.size(); i++) {
+        if (s.sol[i] == l_Undef) continue;
+        const uint32_t orig = mylib->get_orig_var(anf, i);
+        if (ret.sol.size() <= orig) {
+            ret.sol.resize(orig + 1, l_Undef);
+        }
+        ret.sol[orig] = s.sol[i];
+    }
+    return ret;
+}
+
 void check_solution(const ANF* anf, const Solution& solution)
 {
     //Checking
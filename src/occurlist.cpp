@@ -0,0 +1,162 @@
+/*****************************************************************************
+Copyright (C) 2018  Mate Soos, Davin Choo, Kian Ming A. Chai, DSO National Laboratories
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***********************************************/
+
+#include <algorithm>
+
+#include "occurlist.hpp"
+
+USING_NAMESPACE_PBORI
+
+using namespace BLib;
+using std::vector;
+
+void OccurList::resize(const size_t numVars)
+{
+    lists.resize(numVars);
+}
+
+void OccurList::reserve(const uint32_t var, const size_t extra)
+{
+    const List& l = lists[var];
+    if (l.cap < l.size + extra) {
+        relocate(var, l.size + extra);
+    }
+}
+
+void OccurList::add(const size_t eq, const BooleMonomial& vars)
+{
+    if (eq < gen.size()) {
+        gen[eq]++;
+    } else {
+        gen.resize(eq + 1, 0);
+    }
+    for (const uint32_t var : vars) {
+        push(var, eq);
+    }
+}
+
+void OccurList::update(const size_t eq, const BooleMonomial& prevVars,
+                       const BooleMonomial& currVars)
+{
+    // All entries of the previous generation go stale at once
+    gen[eq]++;
+    for (const uint32_t var : prevVars) {
+        assert(lists[var].live > 0);
+        lists[var].live--;
+    }
+    for (const uint32_t var : currVars) {
+        push(var, eq);
+    }
+}
+
+void OccurList::push(const uint32_t var, const size_t eq)
+{
+    if (lists[var].size == lists[var].cap) {
+        // Many stale entries: make room in place, otherwise move
+        if (lists[var].size > 2 * lists[var].live + 8) {
+            compactList(var);
+        } else {
+            relocate(var, std::max<uint32_t>(4, 2 * lists[var].cap));
+        }
+    }
+
+    List& l = lists[var];
+    pool[l.begin + l.size] = Entry{(uint32_t)eq, gen[eq]};
+    l.size++;
+    l.live++;
+}
+
+void OccurList::compactList(const uint32_t var)
+{
+    List& l = lists[var];
+    Entry* const beg = pool.data() + l.begin;
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < l.size; i++) {
+        if (gen[beg[i].eq] == beg[i].gen) {
+            beg[kept++] = beg[i];
+        }
+    }
+    assert(kept == l.live);
+    l.size = kept;
+}
+
+void OccurList::relocate(const uint32_t var, const uint32_t cap)
+{
+    // Moving lists leaves holes behind, once they are most of the array
+    // it is cheaper to rebuild it
+    if (garbage > pool.size() / 2 && garbage > 1024) {
+        compactPool();
+        if (lists[var].cap >= cap) {
+            return;
+        }
+    }
+
+    List& l = lists[var];
+    const size_t begin = pool.size();
+    pool.resize(begin + cap);
+    std::copy(pool.begin() + l.begin, pool.begin() + l.begin + l.size,
+              pool.begin() + begin);
+    garbage += l.cap;
+    l.begin = begin;
+    l.cap = cap;
+}
+
+void OccurList::compactPool()
+{
+    vector<Entry> newPool;
+    newPool.reserve(pool.size() - garbage);
+    for (List& l : lists) {
+        const size_t begin = newPool.size();
+        for (uint32_t i = 0; i < l.size; i++) {
+            const Entry& e = pool[l.begin + i];
+            if (gen[e.eq] == e.gen) {
+                newPool.push_back(e);
+            }
+        }
+        l.begin = begin;
+        l.size = newPool.size() - begin;
+        assert(l.size == l.live);
+
+        // Leave some room to grow into
+        l.cap = l.size + l.size / 2 + 2;
+        newPool.resize(begin + l.cap);
+    }
+    pool.swap(newPool);
+    garbage = 0;
+}
+
+void OccurList::renumber(const vector<size_t>& newIdx, const size_t numEqs)
+{
+    // Drop stale entries and start over with generation 0
+    for (List& l : lists) {
+        Entry* const beg = pool.data() + l.begin;
+        uint32_t kept = 0;
+        for (uint32_t i = 0; i < l.size; i++) {
+            if (gen[beg[i].eq] == beg[i].gen) {
+                assert(newIdx[beg[i].eq] < numEqs);
+                beg[kept++] = Entry{(uint32_t)newIdx[beg[i].eq], 0};
+            }
+        }
+        l.size = kept;
+    }
+    gen.assign(numEqs, 0);
+}
@@ -0,0 +1,106 @@
+/*****************************************************************************
+Copyright (C) 2018  Mate Soos, Davin Choo, Kian Ming A. Chai, DSO National Laboratories
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***********************************************/
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <polybori/polybori.h>
+
+namespace BLib {
+
+// For each variable, the equations it occurs in. All lists live in one
+// array, each in its own segment, which is moved to the end of the array
+// when it fills up. Equations are never searched for and removed one by
+// one: when the variables of an equation change, it gets a new generation
+// and is listed again, and the entries of older generations are skipped,
+// then dropped when the list is compacted.
+class OccurList
+{
+   public:
+    void resize(size_t numVars);
+
+    // Makes room for 'extra' more equations in the list of 'var'
+    void reserve(uint32_t var, size_t extra);
+
+    // A new equation, with these variables
+    void add(size_t eq, const polybori::BooleMonomial& vars);
+
+    // The variables of an equation changed from 'prevVars' to 'currVars'
+    void update(size_t eq, const polybori::BooleMonomial& prevVars,
+                const polybori::BooleMonomial& currVars);
+
+    // Equations have been removed and moved around: equation 'i' is now
+    // at newIdx[i]. Only equations without variables may be removed.
+    void renumber(const std::vector<size_t>& newIdx, size_t numEqs);
+
+    size_t numVars() const
+    {
+        return lists.size();
+    }
+
+    // Number of equations 'var' is in
+    size_t size(const uint32_t var) const
+    {
+        return lists[var].live;
+    }
+
+    // Calls f(eq) for each equation 'var' is in
+    template <class F>
+    void forEach(const uint32_t var, F f) const
+    {
+        const List& l = lists[var];
+        const Entry* at = pool.data() + l.begin;
+        const Entry* const end = at + l.size;
+        for (; at != end; ++at) {
+            if (gen[at->eq] == at->gen) {
+                f((size_t)at->eq);
+            }
+        }
+    }
+
+   private:
+    struct Entry {
+        uint32_t eq;
+        uint32_t gen; ///<valid if it is still the generation of 'eq'
+    };
+    struct List {
+        size_t begin = 0; ///<start of the segment in 'pool'
+        uint32_t size = 0;
+        uint32_t cap = 0;
+        uint32_t live = 0; ///<entries of the current generation
+    };
+
+    void push(uint32_t var, size_t eq);
+    void compactList(uint32_t var);
+    void relocate(uint32_t var, uint32_t cap);
+    void compactPool();
+
+    std::vector<Entry> pool;
+    std::vector<List> lists;
+    std::vector<uint32_t> gen; ///<current generation of each equation
+    size_t garbage = 0;        ///<slots of 'pool' left behind by moved lists
+};
+
+}
@@ -0,0 +1,201 @@
+/*****************************************************************************
+Copyright (C) 2018  Mate Soos, Davin Choo, Kian Ming A. Chai, DSO National Laboratories
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***********************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <polybori/polybori.h>
+
+namespace BLib {
+
+// A set of polynomials, in an open-addressing table of (hash, index) slots
+// with linear probing. The polynomials themselves are kept in one array, so
+// that two with the same hash are told apart, and so that their nodes are
+// not freed and reused while they are in the set. ZDDs are canonical, so
+// equal polynomials share the root node of their diagram.
+class PolySet
+{
+   public:
+    typedef polybori::BoolePolynomial::hash_type hash_type;
+
+    // Returns true if 'p' was not in the set yet
+    bool insert(const polybori::BoolePolynomial& p)
+    {
+        if ((polys.size() + tombs + 1) * 2 > slots.size()) {
+            rehash(std::max<size_t>(16, 4 * (polys.size() + 1)));
+        }
+        const hash_type h = p.hash();
+        size_t tomb = noSlot;
+        for (size_t at = mix(h) & mask();; at = (at + 1) & mask()) {
+            Slot& s = slots[at];
+            if (s.idx == empty) {
+                Slot& to = (tomb != noSlot) ? slots[tomb] : s;
+                if (tomb != noSlot) {
+                    tombs--;
+                }
+                to.hash = h;
+                to.idx = polys.size();
+                polys.push_back(p);
+                return true;
+            }
+            if (s.idx == tomb_idx) {
+                if (tomb == noSlot) {
+                    tomb = at;
+                }
+            } else if (s.hash == h && same(polys[s.idx], p)) {
+                return false;
+            }
+        }
+    }
+
+    // Returns true if 'p' was in the set
+    bool erase(const polybori::BoolePolynomial& p)
+    {
+        const size_t at = find(p);
+        if (at == noSlot) {
+            return false;
+        }
+
+        // Move the last polynomial into the hole
+        const uint32_t idx = slots[at].idx;
+        slots[at].idx = tomb_idx;
+        tombs++;
+        const uint32_t last = polys.size() - 1;
+        if (idx != last) {
+            const size_t lastAt = findIdx(polys[last].hash(), last);
+            slots[lastAt].idx = idx;
+            polys[idx] = polys[last];
+        }
+        polys.pop_back();
+        return true;
+    }
+
+    bool contains(const polybori::BoolePolynomial& p) const
+    {
+        return find(p) != noSlot;
+    }
+
+    size_t size() const
+    {
+        return polys.size();
+    }
+
+    void reserve(const size_t n)
+    {
+        polys.reserve(n);
+        if ((n + tombs) * 2 > slots.size()) {
+            rehash(2 * n);
+        }
+    }
+
+    void clear()
+    {
+        polys.clear();
+        slots.clear();
+        tombs = 0;
+    }
+
+   private:
+    struct Slot {
+        hash_type hash;
+        uint32_t idx; ///<in 'polys', or empty/tomb_idx
+    };
+    static constexpr uint32_t empty = UINT32_MAX;
+    static constexpr uint32_t tomb_idx = UINT32_MAX - 1;
+    static constexpr size_t noSlot = SIZE_MAX;
+
+    static bool same(const polybori::BoolePolynomial& a,
+                     const polybori::BoolePolynomial& b)
+    {
+        return a.navigation() == b.navigation();
+    }
+
+    // The hash of a polynomial is the address of its root node, whose low
+    // bits are all the same
+    static size_t mix(uint64_t h)
+    {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    size_t mask() const
+    {
+        return slots.size() - 1;
+    }
+
+    size_t find(const polybori::BoolePolynomial& p) const
+    {
+        if (slots.empty()) {
+            return noSlot;
+        }
+        const hash_type h = p.hash();
+        for (size_t at = mix(h) & mask();; at = (at + 1) & mask()) {
+            const Slot& s = slots[at];
+            if (s.idx == empty) {
+                return noSlot;
+            }
+            if (s.idx != tomb_idx && s.hash == h && same(polys[s.idx], p)) {
+                return at;
+            }
+        }
+    }
+
+    size_t findIdx(const hash_type h, const uint32_t idx) const
+    {
+        for (size_t at = mix(h) & mask();; at = (at + 1) & mask()) {
+            assert(slots[at].idx != empty);
+            if (slots[at].idx == idx) {
+                return at;
+            }
+        }
+    }
+
+    void rehash(size_t minSlots)
+    {
+        size_t num = 16;
+        while (num < minSlots) {
+            num *= 2;
+        }
+        slots.assign(num, Slot{0, empty});
+        tombs = 0;
+        for (uint32_t i = 0; i < polys.size(); i++) {
+            const hash_type h = polys[i].hash();
+            size_t at = mix(h) & mask();
+            while (slots[at].idx != empty) {
+                at = (at + 1) & mask();
+            }
+            slots[at] = Slot{h, i};
+        }
+    }
+
+    std::vector<polybori::BoolePolynomial> polys;
+    std::vector<Slot> slots;
+    size_t tombs = 0;
+};
+
+}
@@ -25,6 +25,8 @@ SOFTWARE.
 #include <iostream>
 #include <fstream>
 #include "anf.hpp"
+#include "anfbinary.hpp"
+#include "anfutils.hpp"
 
 using std::cout;
 using std::endl;
@@ -44,16 +46,14 @@ bool Replacer::evaluate(const vector<lbool>& vals) const
         ret &= (vals[num] == *it);
     }
 
-    num = 0;
-    for (vector<Lit>::const_iterator it = replaceTable.begin(),
-                                     end = replaceTable.end();
-         it != end; it++, num++) {
-        if (num == it->var())
+    for (num = 0; num < parent.size(); num++) {
+        const Lit lit = find(num);
+        if (num == lit.var())
             continue;
 
-        assert(vals.size() >= it->var());
+        assert(vals.size() >= lit.var());
         assert(vals.size() >= num);
-        lbool one = vals[it->var()] ^ it->sign();
+        lbool one = vals[lit.var()] ^ lit.sign();
         lbool other = vals[num];
         ret &= (one == other);
     }
@@ -77,7 +77,7 @@ bool Replacer::evaluate(const vector<lbool>& vals) const
  *              = (1+d)*(e)*(1+f)
  *              = a*b*c
  */
-BoolePolynomial Replacer::update(const BooleMonomial& m) const
+BoolePolynomial Replacer::substitute(const BooleMonomial& m) const
 {
     BoolePolynomial ret(true, m.ring());
 
@@ -89,8 +89,8 @@ BoolePolynomial Replacer::update(const BooleMonomial& m) const
                 return BoolePolynomial(m.ring());
         }
 
-        assert(replaceTable.size() > v); //Variable must exist
-        const Lit lit = replaceTable[v];
+        assert(parent.size() > v); //Variable must exist
+        const Lit lit = find(v);
 
         BoolePolynomial alsoAdd(m.ring());
         if (lit.sign())
@@ -102,8 +102,45 @@ BoolePolynomial Replacer::update(const BooleMonomial& m) const
     return ret;
 }
 
+BoolePolynomial Replacer::update(const BooleMonomial& m) const
+{
+    // Linear terms are cheaper to substitute than to look up
+    if (m.deg() < 2) {
+        return substitute(m);
+    }
+
+    const auto it = cache.find(m.hash());
+    if (it != cache.end() && it->second.mono == m) {
+        bool fresh = true;
+        for (const uint32_t v : m) {
+            if (epoch[v] > it->second.stamp) {
+                fresh = false;
+                break;
+            }
+        }
+        if (fresh) {
+            return it->second.poly;
+        }
+    }
+
+    BoolePolynomial ret = substitute(m);
+    if (it != cache.end()) {
+        it->second = CachedMono{m, ret, clock};
+    } else {
+        if (cache.size() >= (1U << 20)) {
+            cache.clear();
+        }
+        cache.emplace(m.hash(), CachedMono{m, ret, clock});
+    }
+    return ret;
+}
+
 BoolePolynomial Replacer::update(const BoolePolynomial& eq) const
 {
+    if (eq.deg() <= 2) {
+        return updateQuadratic(eq);
+    }
+
     BoolePolynomial ret = BoolePolynomial(eq.ring());
     for (const BooleMonomial& mono : eq) {
         ret += update(mono);
@@ -111,12 +148,59 @@ BoolePolynomial Replacer::update(const BoolePolynomial& eq) const
     return ret;
 }
 
+// Each term of a polynomial of degree at most 2 expands to at most four
+// terms, which are all summed up at once instead of one ZDD operation each
+BoolePolynomial Replacer::updateQuadratic(const BoolePolynomial& eq) const
+{
+    PolynomialBuilder builder(eq.ring());
+    for (const BooleMonomial& mono : eq) {
+        // Each variable is either TRUE or becomes a literal of its root
+        uint32_t vars[2];
+        bool signs[2];
+        size_t n = 0;
+        bool zero = false;
+        for (const uint32_t v : mono) {
+            if (value[v] != l_Undef) {
+                if (value[v] == l_False) {
+                    zero = true;
+                    break;
+                }
+                continue;
+            }
+            assert(n < 2);
+            const Lit lit = find(v);
+            vars[n] = lit.var();
+            signs[n] = lit.sign();
+            n++;
+        }
+        if (zero) {
+            continue;
+        }
+
+        // (x + s)*(y + t) = x*y + t*x + s*y + s*t
+        if (n == 0) {
+            builder.addConstant(true);
+        } else if (n == 1) {
+            builder.addMonomial(vars, vars + 1);
+            builder.addConstant(signs[0]);
+        } else {
+            builder.addMonomial(vars, vars + 2);
+            if (signs[1])
+                builder.addMonomial(vars, vars + 1);
+            if (signs[0])
+                builder.addMonomial(vars + 1, vars + 2);
+            builder.addConstant(signs[0] && signs[1]);
+        }
+    }
+    return builder.build();
+}
+
 bool Replacer::willUpdate(const BoolePolynomial& eq) const
 {
     for (const uint32_t v : eq.usedVariables()) {
         if (value[v] != l_Undef)
             return true;
-        if (replaceTable[v] != Lit(v, false))
+        if (parent[v] != Lit(v, false))
             return true;
     }
     return false;
@@ -128,10 +212,9 @@ vector<uint32_t> Replacer::setValue(uint32_t var, bool val)
     alsoUpdated.push_back(var);
 
     //update to representative
-    if (replaceTable[var] != Lit(var, false)) {
-        val ^= replaceTable[var].sign();
-        var = replaceTable[var].var();
-    }
+    const Lit root = find(var);
+    val ^= root.sign();
+    var = root.var();
     alsoUpdated.push_back(var);
 
     //set value
@@ -143,19 +226,13 @@ vector<uint32_t> Replacer::setValue(uint32_t var, bool val)
     }
 
     value[var] = boolToLBool(val);
+    touch(var);
 
     //update anti/equivalent variables
-    map<uint32_t, vector<uint32_t> >::iterator it = revReplaceTable.find(var);
-    if (it == revReplaceTable.end()) {
-        return alsoUpdated;
-    }
-
-    vector<uint32_t>& vars = it->second;
-    for (vector<uint32_t>::iterator it2 = vars.begin(), end2 = vars.end();
-         it2 != end2; it2++) {
-        assert(replaceTable[*it2].var() == var);
-        value[*it2] = boolToLBool(replaceTable[*it2].sign() ^ val);
-        alsoUpdated.push_back(*it2);
+    for (uint32_t at = nextInClass[var]; at != var; at = nextInClass[at]) {
+        value[at] = boolToLBool(find(at).sign() ^ val);
+        touch(at);
+        alsoUpdated.push_back(at);
     }
 
     return alsoUpdated;
@@ -163,8 +240,8 @@ vector<uint32_t> Replacer::setValue(uint32_t var, bool val)
 
 vector<uint32_t> Replacer::setReplace(uint32_t var, Lit lit)
 {
-    assert(var < replaceTable.size());
-    assert(lit.var() < replaceTable.size());
+    assert(var < parent.size());
+    assert(lit.var() < parent.size());
 
     vector<uint32_t> ret;
 
@@ -177,10 +254,10 @@ vector<uint32_t> Replacer::setReplace(uint32_t var, Lit lit)
         return setValue(var, (value[lit.var()] ^ lit.sign()) == l_True);
     }
 
-    //move forward
-    lit ^= replaceTable[var].sign();
-    var = replaceTable[var].var();
-    lit = replaceTable[lit.var()] ^ lit.sign();
+    //move forward to the roots: var's root = other root ^ sign
+    const Lit varRoot = find(var);
+    lit = find(lit.var()) ^ lit.sign() ^ varRoot.sign();
+    var = varRoot.var();
     ret.push_back(lit.var());
     ret.push_back(var);
 
@@ -192,84 +269,134 @@ vector<uint32_t> Replacer::setReplace(uint32_t var, Lit lit)
         return ret;
     }
 
-    //lit.var() is not the head of a replace group
-    if (revReplaceTable.find(lit.var()) == revReplaceTable.end()) {
-        replaceTable[lit.var()] = Lit(var, lit.sign());
-        revReplaceTable[var].push_back(lit.var());
+    //union by size: the smaller class goes under the root of the larger,
+    //only its members are replaced with something new
+    uint32_t root = var;
+    uint32_t child = lit.var();
+    if (classSize[root] < classSize[child]) {
+        std::swap(root, child);
+    }
+    touch(child);
+    for (uint32_t at = nextInClass[child]; at != child; at = nextInClass[at]) {
+        ret.push_back(at);
+        touch(at);
+    }
+    parent[child] = Lit(root, lit.sign());
+    classSize[root] += classSize[child];
+    std::swap(nextInClass[root], nextInClass[child]);
 
-        //These may have been updated
-        for (vector<uint32_t>::const_iterator it = revReplaceTable[var].begin(),
-                                              end = revReplaceTable[var].end();
-             it != end; it++) {
-            ret.push_back(*it);
+    return ret;
+}
+
+void Replacer::saveBinary(BinaryWriter& w) const
+{
+    w.writeVarint(ok);
+
+    // Only set and replaced variables, as (difference to previous var, data)
+    w.writeVarint(getNumSetVars());
+    uint32_t prev = 0;
+    for (uint32_t v = 0; v < value.size(); v++) {
+        if (value[v] != l_Undef) {
+            w.writeVarint(v - prev);
+            w.writeVarint(value[v] == l_True);
+            prev = v;
         }
-        return ret;
     }
 
-    //var is not the head of a replace group
-    if (revReplaceTable.find(var) == revReplaceTable.end()) {
-        replaceTable[var] = lit;
-        revReplaceTable[lit.var()].push_back(var);
-
-        //These may have been updated
-        for (vector<uint32_t>::const_iterator
-                 it = revReplaceTable[lit.var()].begin(),
-                 end = revReplaceTable[lit.var()].end();
-             it != end; it++) {
-            ret.push_back(*it);
+    w.writeVarint(getNumReplacedVars());
+    prev = 0;
+    for (uint32_t v = 0; v < parent.size(); v++) {
+        const Lit lit = find(v);
+        if (lit != Lit(v, false)) {
+            w.writeVarint(v - prev);
+            w.writeVarint(lit.toInt());
+            prev = v;
         }
-
-        return ret;
     }
+}
 
-    //both are dependent, move lit's dependencies under var
-    assert(revReplaceTable.find(lit.var()) != revReplaceTable.end());
-    assert(revReplaceTable.find(var) != revReplaceTable.end());
+void Replacer::loadBinary(BinaryReader& r)
+{
+    const size_t numVars = value.size();
+    auto checkVar = [&](const uint64_t v) {
+        if (v >= numVars) {
+            cout << "ERROR: variable " << v << " in binary ANF file is out of "
+                 << "range, there are only " << numVars << " variables" << endl;
+            exit(-1);
+        }
+    };
+
+    ok = r.readVarint();
+    cache.clear();
+
+    value.assign(numVars, l_Undef);
+    uint64_t numSet = r.readVarint();
+    uint64_t v = 0;
+    for (uint64_t i = 0; i < numSet; i++) {
+        v += r.readVarint();
+        checkVar(v);
+        value[v] = boolToLBool(r.readVarint());
+    }
 
-    vector<uint32_t>& vars = revReplaceTable[lit.var()];
-    for (vector<uint32_t>::iterator it = vars.begin(), end = vars.end();
-         it != end; it++) {
-        revReplaceTable[var].push_back(*it);
-        replaceTable[*it] = Lit(var, replaceTable[*it].sign() ^ lit.sign());
-        ret.push_back(*it);
+    for (uint32_t i = 0; i < numVars; i++) {
+        parent[i] = Lit(i, false);
+        classSize[i] = 1;
+        nextInClass[i] = i;
     }
-    revReplaceTable.erase(revReplaceTable.find(lit.var()));
-    replaceTable[lit.var()] = Lit(var, lit.sign());
-    revReplaceTable[var].push_back(lit.var());
-
-    //These may have been updated
-    for (vector<uint32_t>::const_iterator it = revReplaceTable[var].begin(),
-                                          end = revReplaceTable[var].end();
-         it != end; it++) {
-        ret.push_back(*it);
+    uint64_t numReplaced = r.readVarint();
+    v = 0;
+    for (uint64_t i = 0; i < numReplaced; i++) {
+        v += r.readVarint();
+        checkVar(v);
+        const Lit lit = Lit::toLit(r.readVarint());
+        checkVar(lit.var());
+        parent[v] = lit;
     }
 
-    return ret;
+    // Vars are stored replaced by their roots, which are not replaced
+    for (uint32_t i = 0; i < numVars; i++) {
+        const uint32_t root = parent[i].var();
+        if (root == i) {
+            continue;
+        }
+        if (parent[root].var() != root) {
+            cout << "ERROR: variable " << i << " in binary ANF file is "
+                 << "replaced by " << root << ", which is also replaced"
+                 << endl;
+            exit(-1);
+        }
+        classSize[root]++;
+        nextInClass[i] = nextInClass[root];
+        nextInClass[root] = i;
+    }
 }
 
-void Replacer::print_solution_map(std::ofstream* ofs)
+void Replacer::print_solution_map(std::ofstream* ofs,
+                                  const vector<uint32_t>& origVars)
 {
+    auto name = [&](const uint32_t v) {
+        return origVars.empty() ? v : origVars[v];
+    };
+
     uint32_t num = 0;
     for (vector<lbool>::const_iterator it = value.begin(), end = value.end();
          it != end; it++, num++) {
         if (*it != l_Undef) {
-            (*ofs) << "ANF-var-val " << num << " = " << *it << endl;
+            (*ofs) << "ANF-var-val " << name(num) << " = " << *it << endl;
         }
     }
 
-    num = 0;
-    for (vector<Lit>::const_iterator it = replaceTable.begin(), end = replaceTable.end();
-        it != end; it++, num++
-    ) {
+    for (num = 0; num < parent.size(); num++) {
+        const Lit lit = find(num);
         //it is not replaced
-        if (it->var() == num)
+        if (lit.var() == num)
             continue;
 
         //maybe never solved for, because equation is "a = b", and neither "a", nor "b" appear anywhere else
         //so, just set the value randomly... to true :)
-        (*ofs) << "must-set-ANF-var-to-any " << it->var() << endl;
-        (*ofs) << "ANF-var " << num << " = "
-               << "ANF-var " << it->var() << " ^ " << it->sign() << endl;
+        (*ofs) << "must-set-ANF-var-to-any " << name(lit.var()) << endl;
+        (*ofs) << "ANF-var " << name(num) << " = "
+               << "ANF-var " << name(lit.var()) << " ^ " << lit.sign() << endl;
     }
 }
 
@@ -277,8 +404,7 @@ set<size_t> Replacer::get_proj_map(const set<size_t>& vars) const {
     set<size_t> ret;
     for(const auto& v: vars) {
         if (value[v] != l_Undef) continue;
-        Lit l;
-        l = replaceTable[v];
+        const Lit l = find(v);
         if (value[l.var()] != l_Undef) continue;
         ret.insert(l.var());
     }
@@ -298,25 +424,23 @@ void Replacer::get_solution_map(map<uint32_t, VarMap>& ret) const
         }
     }
 
-    num = 0;
-    for (vector<Lit>::const_iterator it = replaceTable.begin(), end = replaceTable.end();
-        it != end; it++, num++
-    ) {
+    for (num = 0; num < parent.size(); num++) {
+        const Lit lit = find(num);
         //it is not replaced
-        if (it->var() == num)
+        if (lit.var() == num)
             continue;
 
         //Don't overwrite existing value with this
-        if (ret.find(it->var()) == ret.end()) {
+        if (ret.find(lit.var()) == ret.end()) {
             VarMap m;
             m.type = Bosph::VarMap::must_set;
-            ret[it->var()] = m;
+            ret[lit.var()] = m;
         }
 
         VarMap m2;
         m2.type = Bosph::VarMap::anf_repl;
-        m2.other_var = it->var();
-        m2.inv = it->sign();
+        m2.other_var = lit.var();
+        m2.inv = lit.sign();
         ret[num] = m2;
     }
 
@@ -348,26 +472,24 @@ vector<lbool> Replacer::extendSolution(const vector<lbool>& solution) const
     }
 
     //Add replaced variables
-    assert(sol2.size() == replaceTable.size());
-    num = 0;
-    for (vector<Lit>::const_iterator it = replaceTable.begin(),
-                                     end = replaceTable.end();
-         it != end; it++, num++) {
+    assert(sol2.size() == parent.size());
+    for (num = 0; num < parent.size(); num++) {
+        const Lit lit = find(num);
         //uint32_t is not replaced
-        if (it->var() == num)
+        if (lit.var() == num)
             continue;
 
         //maybe never solved for, because equation is "a = b", and neither "a", nor "b" appear anywhere else
         //so, just set the value randomly... to true :)
-        if (sol2[it->var()] == l_Undef)
-            sol2[it->var()] = l_True;
+        if (sol2[lit.var()] == l_Undef)
+            sol2[lit.var()] = l_True;
 
-        const lbool val = sol2[it->var()] ^ it->sign();
+        const lbool val = sol2[lit.var()] ^ lit.sign();
         if (sol2[num] != l_Undef && sol2[num] != val) {
-            cout << "num:" << num << " var:" << it->var()
-                 << "sign: " << (int)it->sign() << endl;
+            cout << "num:" << num << " var:" << lit.var()
+                 << "sign: " << (int)lit.sign() << endl;
             cout << "sol2[num]: " << sol2[num]
-                 << " sol2[it->var()]:" << sol2[it->var()] << endl;
+                 << " sol2[lit.var()]:" << sol2[lit.var()] << endl;
             cout << "Solved replaced solution and stored solution differ!"
                  << endl;
             exit(-1);
@@ -25,6 +25,7 @@ SOFTWARE.
 
 #include <map>
 #include <set>
+#include <unordered_map>
 #include <vector>
 #include "bosphincludes.hpp"
 #include <polybori/polybori.h>
@@ -39,6 +40,8 @@ using std::vector;
 namespace BLib {
 
 class ANF;
+class BinaryWriter;
+class BinaryReader;
 
 class Replacer
 {
@@ -52,8 +55,11 @@ class Replacer
         assert(value.size() == var);
         value.push_back(l_Undef);
 
-        assert(replaceTable.size() == var);
-        replaceTable.push_back(Lit(var, false));
+        assert(parent.size() == var);
+        parent.push_back(Lit(var, false));
+        classSize.push_back(1);
+        nextInClass.push_back(var);
+        epoch.push_back(0);
     }
 
     //returns updated vars
@@ -66,7 +72,15 @@ class Replacer
     bool evaluate(const vector<lbool>& vals) const;
     vector<lbool> extendSolution(const vector<lbool>& solution) const;
     void setNOTOK();
-    void print_solution_map(std::ofstream* ofs);
+    // origVars, if not empty, gives the name of each variable in the output
+    void print_solution_map(std::ofstream* ofs,
+                            const vector<uint32_t>& origVars);
+    void print(std::ostream& os, const vector<uint32_t>& origVars) const;
+
+    // Values and replacements, for binary ANF files. Loading replaces the
+    // current state; the number of variables must match.
+    void saveBinary(BinaryWriter& w) const;
+    void loadBinary(BinaryReader& r);
     void get_solution_map(map<uint32_t, VarMap>& ret) const;
     set<size_t> get_proj_map(const set<size_t>& vars) const;
 
@@ -83,10 +97,33 @@ class Replacer
     vector<uint32_t> getReplacesVars(const uint32_t var) const;
 
    private:
-    //uint32_t-to-equi/antivalent var
+    // Root of the class and the parity to it, compressing the path on
+    // the way up
+    Lit find(uint32_t var) const;
+    BoolePolynomial substitute(const BooleMonomial& m) const;
+    BoolePolynomial updateQuadratic(const BoolePolynomial& eq) const;
+    void touch(uint32_t var);
+
     vector<lbool> value;
-    vector<Lit> replaceTable;
-    map<uint32_t, vector<uint32_t> > revReplaceTable;
+
+    // Equi/antivalent vars, as a union-find with parity. Each var points to
+    // its parent, roots point to themselves. The members of each class are
+    // in a circular list, so they can be listed when they are needed.
+    mutable vector<Lit> parent;
+    vector<uint32_t> classSize;   ///<number of vars in class, for roots
+    vector<uint32_t> nextInClass; ///<next member of the same class
+
+    // Substituted monomials, by hash. An entry is valid as long as none of
+    // its variables was set or replaced since it was computed, i.e. their
+    // epochs are not newer than its stamp.
+    struct CachedMono {
+        BooleMonomial mono;
+        BoolePolynomial poly;
+        uint64_t stamp;
+    };
+    mutable std::unordered_map<BooleMonomial::hash_type, CachedMono> cache;
+    vector<uint64_t> epoch; ///<clock at the last change of each var
+    uint64_t clock = 0;
 
     //state
     bool ok;
@@ -105,20 +142,47 @@ inline const vector<lbool>& Replacer::getValues() const
     return value;
 }
 
+inline Lit Replacer::find(const uint32_t var) const
+{
+    uint32_t root = var;
+    bool sign = false;
+    while (parent[root].var() != root) {
+        sign ^= parent[root].sign();
+        root = parent[root].var();
+    }
+
+    uint32_t at = var;
+    bool atSign = sign;
+    while (at != root) {
+        const Lit next = parent[at];
+        parent[at] = Lit(root, atSign);
+        atSign ^= next.sign();
+        at = next.var();
+    }
+    return Lit(root, sign);
+}
+
+inline void Replacer::touch(const uint32_t var)
+{
+    epoch[var] = ++clock;
+}
+
 inline Lit Replacer::getReplaced(const uint32_t var) const
 {
-    assert(replaceTable.size() > var);
-    return replaceTable[var];
+    assert(parent.size() > var);
+    return find(var);
 }
 
 inline vector<uint32_t> Replacer::getReplacesVars(const uint32_t var) const
 {
-    auto it = revReplaceTable.find(var);
-    if (it == revReplaceTable.end()) {
-        return vector<uint32_t>();
-    } else {
-        return it->second;
+    vector<uint32_t> ret;
+    if (parent[var].var() != var) {
+        return ret;
     }
+    for (uint32_t at = nextInClass[var]; at != var; at = nextInClass[at]) {
+        ret.push_back(at);
+    }
+    return ret;
 }
 
 inline void Replacer::setNOTOK()
@@ -139,11 +203,8 @@ inline size_t Replacer::getNumVars() const
 inline size_t Replacer::getNumUnknownVars() const
 {
     size_t ret = 0;
-    size_t num = 0;
-    for (vector<Lit>::const_iterator it = replaceTable.begin(),
-                                     end = replaceTable.end();
-         it != end; it++, num++) {
-        if (num == it->var() && value[num] == l_Undef)
+    for (uint32_t num = 0; num < parent.size(); num++) {
+        if (parent[num].var() == num && value[num] == l_Undef)
             ret++;
     }
 
@@ -153,11 +214,8 @@ inline size_t Replacer::getNumUnknownVars() const
 inline size_t Replacer::getNumReplacedVars() const
 {
     size_t ret = 0;
-    size_t num = 0;
-    for (vector<Lit>::const_iterator it = replaceTable.begin(),
-                                     end = replaceTable.end();
-         it != end; it++, num++) {
-        if (num != it->var())
+    for (uint32_t num = 0; num < parent.size(); num++) {
+        if (num != parent[num].var())
             ret++;
     }
 
@@ -176,20 +234,24 @@ inline size_t Replacer::getNumSetVars() const
     return ret;
 }
 
-inline std::ostream& operator<<(std::ostream& os, const Replacer& repl)
+inline void Replacer::print(std::ostream& os,
+                            const vector<uint32_t>& origVars) const
 {
+    auto name = [&](const uint32_t v) {
+        return origVars.empty() ? v : origVars[v];
+    };
+
     //print values
     os << "c -------------" << std::endl;
     os << "c Fixed values" << std::endl;
     os << "c -------------" << std::endl;
     uint32_t num = 0;
-    for (vector<lbool>::const_iterator it = repl.value.begin(),
-                                       end = repl.value.end();
+    for (vector<lbool>::const_iterator it = value.begin(), end = value.end();
          it != end; it++, num++) {
         if (*it == l_Undef)
             continue;
 
-        os << "x(" << num << ")";
+        os << "x(" << name(num) << ")";
         if (*it == l_True)
             os << " + 1";
         os << std::endl;
@@ -199,28 +261,30 @@ inline std::ostream& operator<<(std::ostream& os, const Replacer& repl)
     os << "c -------------" << std::endl;
     os << "c Equivalences" << std::endl;
     os << "c -------------" << std::endl;
-    num = 0;
-    for (vector<Lit>::const_iterator it = repl.replaceTable.begin(),
-                                     end = repl.replaceTable.end();
-         it != end; it++, num++) {
-        if (*it == Lit(num, false) || repl.getValue(num) != l_Undef)
+    for (num = 0; num < parent.size(); num++) {
+        const Lit lit = find(num);
+        if (lit == Lit(num, false) || getValue(num) != l_Undef)
             continue;
 
-        os << "x(" << num << ") + x(" << it->var() << ")";
-        if (it->sign())
+        os << "x(" << name(num) << ") + x(" << name(lit.var()) << ")";
+        if (lit.sign())
             os << " + 1";
         os << std::endl;
     }
 
     //If UNSAT, it's easy to indicate that: 1 = 0
-    if (!repl.ok) {
+    if (!ok) {
         os << "c -------------" << std::endl;
         os << "c because of Fixed & Equivalences, it is UNSAT" << std::endl;
         os << "c -------------" << std::endl;
         os << "1" << std::endl;
     }
-    os << "c UNSAT : " << std::boolalpha << !repl.ok << std::endl;
+    os << "c UNSAT : " << std::boolalpha << !ok << std::endl;
+}
 
+inline std::ostream& operator<<(std::ostream& os, const Replacer& repl)
+{
+    repl.print(os, vector<uint32_t>());
     return os;
 }
 
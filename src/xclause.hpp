@@ -48,6 +48,17 @@ class XClause
         return vars.empty();
     }
 
+    const vector<uint32_t>& getVars() const
+    {
+        return vars;
+    }
+
+    // XOR of the variables must equal this
+    bool getRHS() const
+    {
+        return rhs;
+    }
+
     friend std::ostream& operator<<(std::ostream& os, const XClause& xcl);
 
    private:
@@ -0,0 +1,118 @@
+/*****************************************************************************
+Copyright (C) 2018  Mate Soos, Davin Choo, Kian Ming A. Chai, DSO National Laboratories
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***********************************************/
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "xorfinder.hpp"
+
+using namespace BLib;
+using Bosph::Clause;
+
+namespace {
+
+struct VarsHash {
+    size_t operator()(const vector<uint32_t>& vars) const
+    {
+        size_t h = vars.size();
+        for (const uint32_t v : vars) {
+            h = h * 31 + v;
+        }
+        return h;
+    }
+};
+
+// The clauses over one set of variables, as (sign pattern, clause index).
+// Bit 'i' of the pattern is the sign of the literal of the i-th variable.
+typedef vector<std::pair<uint32_t, uint32_t> > Group;
+
+}
+
+XorFinder::XorFinder(const vector<Clause>& clauses, const uint32_t maxSize)
+{
+    covered.resize(clauses.size(), 0);
+
+    std::unordered_map<vector<uint32_t>, Group, VarsHash> groups;
+    vector<Lit> lits;
+    vector<uint32_t> vars;
+    for (uint32_t i = 0; i < clauses.size(); i++) {
+        const vector<Lit>& cl = clauses[i].getLits();
+        if (cl.size() < 2 || cl.size() > maxSize) {
+            continue;
+        }
+
+        lits = cl;
+        std::sort(lits.begin(), lits.end(),
+                  [](const Lit a, const Lit b) { return a.var() < b.var(); });
+        vars.clear();
+        uint32_t pattern = 0;
+        bool ok = true;
+        for (const Lit l : lits) {
+            if (!vars.empty() && vars.back() == l.var()) {
+                ok = false;
+                break;
+            }
+            pattern |= (uint32_t)l.sign() << vars.size();
+            vars.push_back(l.var());
+        }
+        if (ok) {
+            groups[vars].push_back(std::make_pair(pattern, i));
+        }
+    }
+
+    // A clause forbids the assignment that makes all its literals false,
+    // i.e. var 'i' = sign of its literal. All 2^(k-1) assignments of one
+    // parity forbidden means the XOR of the vars is the other parity.
+    vector<char> seen;
+    for (auto& g : groups) {
+        const vector<uint32_t>& gvars = g.first;
+        const Group& group = g.second;
+        const uint32_t needed = 1U << (gvars.size() - 1);
+        if (group.size() < needed) {
+            continue;
+        }
+
+        for (uint32_t parity = 0; parity < 2; parity++) {
+            seen.assign(1U << gvars.size(), 0);
+            uint32_t found = 0;
+            for (const auto& p : group) {
+                if ((uint32_t)__builtin_popcount(p.first) % 2 == parity
+                    && !seen[p.first]
+                ) {
+                    seen[p.first] = 1;
+                    found++;
+                }
+            }
+            if (found < needed) {
+                continue;
+            }
+
+            xors.push_back(XClause(gvars, parity == 0));
+            for (const auto& p : group) {
+                if ((uint32_t)__builtin_popcount(p.first) % 2 == parity) {
+                    covered[p.second] = 1;
+                    numCovered++;
+                }
+            }
+        }
+    }
+}
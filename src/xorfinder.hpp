@@ -0,0 +1,62 @@
+/*****************************************************************************
+Copyright (C) 2018  Mate Soos, Davin Choo, Kian Ming A. Chai, DSO National Laboratories
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***********************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "bosphincludes.hpp"
+#include "xclause.hpp"
+
+namespace BLib {
+
+// Recovers XOR constraints that a CNF encodes as the 2^(k-1) clauses over
+// the same k variables, each forbidding one assignment of the wrong parity.
+// Clauses are grouped by their sorted variable sets through a hash map.
+class XorFinder
+{
+   public:
+    // Only XORs of 2..maxSize variables are looked for
+    XorFinder(const std::vector<Bosph::Clause>& clauses, uint32_t maxSize);
+
+    const std::vector<XClause>& getXors() const
+    {
+        return xors;
+    }
+
+    bool isCovered(const size_t clauseIdx) const
+    {
+        return covered[clauseIdx];
+    }
+
+    size_t getNumCovered() const
+    {
+        return numCovered;
+    }
+
+   private:
+    std::vector<char> covered;
+    std::vector<XClause> xors;
+    size_t numCovered = 0;
+};
+
+}
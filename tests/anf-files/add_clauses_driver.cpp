@@ -0,0 +1,86 @@
+/*****************************************************************************
+Copyright (C) 2018  Mate Soos, Davin Choo, Kian Ming A. Chai, DSO National Laboratories
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+***********************************************/
+
+// Reads a DIMACS file and hands all of its clauses to
+// Bosphorus::add_clauses() in one go, then writes the resulting ANF.
+// Used by the lit tests as %add-clauses.
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bosphorus.hpp"
+
+using std::cout;
+using std::endl;
+
+int main(int argc, char** argv)
+{
+    if (argc != 3) {
+        cout << "Usage: " << argv[0] << " <input.cnf> <output.anf>" << endl;
+        exit(-1);
+    }
+
+    std::ifstream in(argv[1]);
+    if (!in) {
+        cout << "ERROR: cannot open \"" << argv[1] << "\"" << endl;
+        exit(-1);
+    }
+
+    uint32_t numVars = 0;
+    std::vector<int> lits;
+    std::vector<size_t> offsets(1, 0);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream ss(line);
+        std::string tok;
+        if (!(ss >> tok) || tok == "c") {
+            continue;
+        }
+        if (tok == "p") {
+            std::string fmt;
+            ss >> fmt >> numVars;
+            continue;
+        }
+        ss.clear();
+        ss.str(line);
+        int lit;
+        while (ss >> lit) {
+            if (lit == 0) {
+                offsets.push_back(lits.size());
+            } else {
+                lits.push_back(lit);
+            }
+        }
+    }
+
+    Bosph::Bosphorus mylib;
+    Bosph::ANF* anf = mylib.start_cnf_input(numVars);
+    mylib.add_clauses(anf, lits.data(), offsets.data(), offsets.size() - 1);
+    mylib.write_anf(argv[2], anf);
+    Bosph::Bosphorus::delete_anf(anf);
+
+    return 0;
+}